@@ -0,0 +1,129 @@
+#include "main.h"
+
+#define APPEND_CACHE_SIZE 8
+
+/**
+ * struct append_entry_s - one cached ">>" target
+ * @path: path as written in the redirection, NULL if the slot is free
+ * @fd: O_APPEND fd, close-on-exec and above 10
+ * @dev: device of the file when it was opened
+ * @ino: inode of the file when it was opened
+ * @used: tick of the last use, for LRU eviction
+ */
+typedef struct append_entry_s
+{
+	char *path;
+	int fd;
+	dev_t dev;
+	ino_t ino;
+	unsigned long used;
+} append_entry_t;
+
+static append_entry_t entries[APPEND_CACHE_SIZE];
+static unsigned long tick;
+
+/**
+ * drop_entry - closes and frees one cache slot
+ * @e: slot
+ */
+static void drop_entry(append_entry_t *e)
+{
+	if (e->path == NULL)
+		return;
+	close(e->fd);
+	free(e->path);
+	e->path = NULL;
+}
+
+/**
+ * append_cache_flush - closes every cached fd
+ *
+ * Description: called by cd, since relative paths now name other files,
+ * and when "set +o appendcache" turns the cache off.
+ */
+void append_cache_flush(void)
+{
+	int i;
+
+	for (i = 0; i < APPEND_CACHE_SIZE; i++)
+		drop_entry(&entries[i]);
+}
+
+/**
+ * append_cache_get - returns an O_APPEND fd for path, reusing a cached one
+ * @path: file a ">>" redirection points at
+ *
+ * Description: a cached fd is only reused while path still names the
+ * same (dev, inode) it was opened on, so a rename, unlink or replacement
+ * of the file is noticed and the file is reopened. The returned fd stays
+ * owned by the cache: dup2() it into place, never close it.
+ *
+ * Return: fd, -1 on error (errno set by open())
+ */
+int append_cache_get(const char *path)
+{
+	struct stat st;
+	append_entry_t *e, *victim = &entries[0];
+	int i, fd, high, found = fstatat(AT_FDCWD, path, &st, 0) == 0;
+
+	for (i = 0; i < APPEND_CACHE_SIZE; i++)
+	{
+		e = &entries[i];
+		if (e->path != NULL && _strcmp(e->path, path) == 0)
+		{
+			if (found && e->dev == st.st_dev && e->ino == st.st_ino)
+			{
+				e->used = ++tick;
+				return (e->fd);
+			}
+			drop_entry(e); /* stale: the path names another file now */
+		}
+		if (victim->path != NULL && (e->path == NULL || e->used < victim->used))
+			victim = e;
+	}
+	fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	if (fd == -1)
+		return (-1);
+	if (fstat(fd, &st) == -1)
+	{
+		close(fd);
+		return (-1);
+	}
+	high = fcntl(fd, F_DUPFD_CLOEXEC, 10); /* keep 3-9 for the user */
+	if (high != -1)
+	{
+		close(fd);
+		fd = high;
+	}
+	drop_entry(victim);
+	victim->path = _strdup(path);
+	if (victim->path == NULL)
+	{
+		close(fd);
+		return (-1);
+	}
+	victim->fd = fd;
+	victim->dev = st.st_dev;
+	victim->ino = st.st_ino;
+	victim->used = ++tick;
+	return (fd);
+}
+
+/**
+ * append_cache_prepare - opens a plan's ">>" targets in the shell itself
+ * @redirs: redirection plan
+ * @n: number of redirections
+ *
+ * Description: called before forking, so the cache lives in the shell
+ * and the child finds every ">>" target already open.
+ */
+void append_cache_prepare(const redir_t *redirs, int n)
+{
+	int i;
+
+	if (!(shell.options & OPT_APPENDCACHE))
+		return;
+	for (i = 0; i < n; i++)
+		if (redirs[i].op == REDIR_APPEND || redirs[i].op == REDIR_BOTH_APPEND)
+			append_cache_get(redirs[i].target);
+}
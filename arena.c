@@ -0,0 +1,152 @@
+#include "main.h"
+
+#define ARENA_BLOCK 65536
+#define ARENA_KEEP (1 << 20)
+#define ARENA_ALIGN 16
+
+/**
+ * struct arena_block_s - one chunk of the per-line arena
+ * @next: next chunk
+ * @size: bytes in @data
+ * @used: bytes handed out from @data
+ * @data: the memory
+ */
+typedef struct arena_block_s
+{
+	struct arena_block_s *next;
+	size_t size;
+	size_t used;
+	char data[];
+} arena_block_t;
+
+static arena_block_t *first, *current;
+static void *last; /* most recent allocation, which can grow in place */
+
+/**
+ * align_up - rounds an address in a block up to ARENA_ALIGN
+ * @b: block
+ *
+ * Return: offset in @b->data of the next aligned byte
+ */
+static size_t align_up(const arena_block_t *b)
+{
+	uintptr_t p = (uintptr_t)(b->data + b->used);
+
+	return (b->used + ((ARENA_ALIGN - p % ARENA_ALIGN) % ARENA_ALIGN));
+}
+
+/**
+ * arena_alloc - allocates memory that lives until the next arena_reset()
+ * @size: number of bytes
+ *
+ * Description: a bump of the current block's offset; a new block is
+ * only malloc'd the first time a line needs more than the blocks kept
+ * from earlier lines, so steady-state lines never call malloc().
+ *
+ * Return: 16-byte aligned memory, NULL if malloc failed
+ */
+void *arena_alloc(size_t size)
+{
+	arena_block_t *b = current, *prev = NULL, *nb;
+	size_t off;
+
+	for (; b != NULL; prev = b, b = b->next)
+	{
+		off = align_up(b);
+		if (off + size <= b->size)
+		{
+			b->used = off + size;
+			current = b;
+			last = b->data + off;
+			return (last);
+		}
+	}
+	nb = malloc(sizeof(arena_block_t) + ARENA_ALIGN +
+				(size > ARENA_BLOCK ? size : ARENA_BLOCK));
+	if (nb == NULL)
+		return (NULL);
+	nb->next = NULL;
+	nb->size = ARENA_ALIGN + (size > ARENA_BLOCK ? size : ARENA_BLOCK);
+	nb->used = 0;
+	if (prev == NULL)
+		first = nb;
+	else
+		prev->next = nb;
+	current = nb;
+	return (arena_alloc(size));
+}
+
+/**
+ * arena_realloc - grows an arena allocation
+ * @p: allocation, or NULL
+ * @old: its current size
+ * @size: new size
+ *
+ * Description: the most recent allocation grows in place when its block
+ * has room, which is the common case for a buffer being appended to.
+ *
+ * Return: the (possibly moved) allocation, NULL if malloc failed
+ */
+void *arena_realloc(void *p, size_t old, size_t size)
+{
+	void *q;
+
+	if (p != NULL && p == last &&
+		(char *)p + size <= current->data + current->size)
+	{
+		current->used = (char *)p - current->data + size;
+		return (p);
+	}
+	q = arena_alloc(size);
+	if (q != NULL && p != NULL)
+		memcpy(q, p, old < size ? old : size);
+	return (q);
+}
+
+/**
+ * arena_strdup - copies a string into the arena
+ * @s: string
+ * @len: number of bytes to copy; a NUL is added
+ *
+ * Return: the copy, NULL if malloc failed
+ */
+char *arena_strdup(const char *s, size_t len)
+{
+	char *copy = arena_alloc(len + 1);
+
+	if (copy != NULL)
+	{
+		memcpy(copy, s, len);
+		copy[len] = '\0';
+	}
+	return (copy);
+}
+
+/**
+ * arena_reset - frees everything allocated since the last reset
+ *
+ * Description: called before each command line. Blocks are kept for
+ * the next line up to ARENA_KEEP bytes in total; a line that needed
+ * more (a huge $(...) output) gives the excess back.
+ */
+void arena_reset(void)
+{
+	arena_block_t *b, *next, **link = &first;
+	size_t kept = 0;
+
+	for (b = first; b != NULL; b = next)
+	{
+		next = b->next;
+		if (kept + b->size > ARENA_KEEP && b != first)
+		{
+			*link = next;
+			free(b);
+			continue;
+		}
+		kept += b->size;
+		b->used = 0;
+		link = &b->next;
+	}
+	current = first;
+	last = NULL;
+}
@@ -0,0 +1,347 @@
+#include "main.h"
+
+/**
+ * struct array_s - the value of an array variable
+ * @assoc: 1 for an associative array (declare -A), 0 for an indexed one
+ * @vals: indexed: vals[i] is element i; associative: the values in the
+ * order their keys were added. NULL where an element was unset.
+ * @keys: associative only, the key of each of @vals
+ * @n: entries of @vals in use (indexed: highest index + 1)
+ * @cap: capacity of @vals (and @keys)
+ * @count: elements set
+ * @slots: associative only, open-addressing index over @keys, each slot
+ * holding a @vals index + 1, 0 when empty
+ * @slots_cap: number of @slots, a power of two
+ *
+ * Description: every string is malloc'd, since arrays outlive the line
+ * that set them.
+ */
+struct array_s
+{
+	int assoc;
+	char **vals;
+	char **keys;
+	size_t n;
+	size_t cap;
+	size_t count;
+	uint32_t *slots;
+	size_t slots_cap;
+};
+
+/**
+ * key_hash - hashes an associative array key (FNV-1a)
+ * @key: key
+ *
+ * Return: hash
+ */
+static uint32_t key_hash(const char *key)
+{
+	uint32_t h = 2166136261u;
+
+	for (; *key != '\0'; key++)
+		h = (h ^ (unsigned char)*key) * 16777619u;
+	return (h);
+}
+
+/**
+ * key_slot - finds a key in an associative array's index
+ * @a: array, with an index
+ * @key: key
+ *
+ * Return: the slot holding it, or the empty slot where it would go
+ */
+static size_t key_slot(const array_t *a, const char *key)
+{
+	size_t i = key_hash(key) & (a->slots_cap - 1);
+
+	while (a->slots[i] != 0 && _strcmp(a->keys[a->slots[i] - 1], key) != 0)
+		i = (i + 1) & (a->slots_cap - 1);
+	return (i);
+}
+
+/**
+ * reindex - compacts an associative array and rebuilds its index
+ * @a: associative array
+ * @cap: number of index slots, a power of two above twice the elements
+ *
+ * Return: 0 on success, -1 if out of memory (the array is unchanged)
+ */
+static int reindex(array_t *a, size_t cap)
+{
+	uint32_t *grown = calloc(cap, sizeof(uint32_t));
+	size_t i, j;
+
+	if (grown == NULL)
+		return (-1);
+	for (i = j = 0; i < a->n; i++)
+		if (a->vals[i] != NULL)
+		{
+			a->keys[j] = a->keys[i];
+			a->vals[j++] = a->vals[i];
+		}
+	a->n = j;
+	free(a->slots);
+	a->slots = grown;
+	a->slots_cap = cap;
+	for (i = 0; i < a->n; i++)
+		a->slots[key_slot(a, a->keys[i])] = i + 1;
+	return (0);
+}
+
+/**
+ * grow - makes room for element @want of @vals (and @keys)
+ * @a: array
+ * @want: index that has to fit
+ *
+ * Return: 0 on success, -1 if out of memory
+ */
+static int grow(array_t *a, size_t want)
+{
+	size_t cap = a->cap ? a->cap : 8;
+	char **vals, **keys;
+
+	while (cap <= want)
+		cap *= 2;
+	if (cap == a->cap)
+		return (0);
+	vals = realloc(a->vals, sizeof(char *) * cap);
+	if (vals == NULL)
+		return (-1);
+	a->vals = vals;
+	memset(vals + a->cap, 0, sizeof(char *) * (cap - a->cap));
+	if (a->assoc)
+	{
+		keys = realloc(a->keys, sizeof(char *) * cap);
+		if (keys == NULL)
+			return (-1);
+		a->keys = keys;
+	}
+	a->cap = cap;
+	return (0);
+}
+
+/**
+ * array_new - creates an empty array
+ * @assoc: 1 for an associative array, 0 for an indexed one
+ *
+ * Return: the array, NULL if out of memory
+ */
+array_t *array_new(int assoc)
+{
+	array_t *a = calloc(1, sizeof(array_t));
+
+	if (a != NULL)
+		a->assoc = assoc;
+	return (a);
+}
+
+/**
+ * array_clear - removes every element
+ * @a: array
+ */
+void array_clear(array_t *a)
+{
+	size_t i;
+
+	for (i = 0; i < a->n; i++)
+	{
+		free(a->vals[i]);
+		a->vals[i] = NULL;
+		if (a->assoc && a->keys[i] != NULL)
+			free(a->keys[i]);
+	}
+	if (a->slots != NULL)
+		memset(a->slots, 0, sizeof(uint32_t) * a->slots_cap);
+	a->n = a->count = 0;
+}
+
+/**
+ * array_free - frees an array and its elements
+ * @a: array, or NULL
+ */
+void array_free(array_t *a)
+{
+	if (a == NULL)
+		return;
+	array_clear(a);
+	free(a->vals);
+	free(a->keys);
+	free(a->slots);
+	free(a);
+}
+
+/**
+ * array_is_assoc - tells an associative array from an indexed one
+ * @a: array
+ *
+ * Return: 1 if associative, 0 if indexed
+ */
+int array_is_assoc(const array_t *a)
+{
+	return (a->assoc);
+}
+
+/**
+ * array_count - number of elements set, as ${#a[@]} gives
+ * @a: array
+ *
+ * Return: count
+ */
+size_t array_count(const array_t *a)
+{
+	return (a->count);
+}
+
+/**
+ * array_length - one past the highest index set, which negative
+ * indices count back from
+ * @a: indexed array
+ *
+ * Return: length
+ */
+size_t array_length(const array_t *a)
+{
+	return (a->n);
+}
+
+/**
+ * array_get - looks up an element
+ * @a: array
+ * @key: key, for an associative array
+ * @index: index, for an indexed one
+ *
+ * Return: the value, owned by the array; NULL if not set
+ */
+const char *array_get(const array_t *a, const char *key, size_t index)
+{
+	if (!a->assoc)
+		return (index < a->n ? a->vals[index] : NULL);
+	if (a->slots_cap == 0)
+		return (NULL);
+	index = key_slot(a, key);
+	return (a->slots[index] ? a->vals[a->slots[index] - 1] : NULL);
+}
+
+/**
+ * array_set - sets an element, adding it if it is new
+ * @a: array
+ * @key: key, for an associative array
+ * @index: index, for an indexed one
+ * @value: value, copied
+ *
+ * Description: an indexed array is a vector, so setting elements in
+ * order is an amortized O(1) append; a gap is left as NULL entries. An
+ * associative array is compacted, dropping unset entries, whenever
+ * they and the live ones fill half its index.
+ *
+ * Return: 0 on success, -1 if out of memory
+ */
+int array_set(array_t *a, const char *key, size_t index, const char *value)
+{
+	char *copy = _strdup(value);
+	size_t i, cap = a->slots_cap ? a->slots_cap : 16;
+
+	if (copy == NULL)
+		return (-1);
+	while ((a->count + 1) * 4 > cap)
+		cap *= 2;
+	if (a->assoc && (a->n + 1) * 2 > a->slots_cap && reindex(a, cap) == -1)
+		index = (size_t)-1;
+	else if (a->assoc)
+	{
+		i = key_slot(a, key);
+		index = a->slots[i] ? a->slots[i] - 1 : a->n;
+		if (!a->slots[i] && grow(a, index) == 0)
+		{
+			a->keys[index] = _strdup(key);
+			if (a->keys[index] == NULL)
+				index = (size_t)-1;
+			else
+				a->slots[i] = index + 1;
+		}
+	}
+	if (index == (size_t)-1 || grow(a, index) == -1)
+	{
+		free(copy);
+		return (-1);
+	}
+	a->count += a->vals[index] == NULL;
+	free(a->vals[index]);
+	a->vals[index] = copy;
+	a->n = index >= a->n ? index + 1 : a->n;
+	return (0);
+}
+
+/**
+ * array_unset - removes an element
+ * @a: array
+ * @key: key, for an associative array
+ * @index: index, for an indexed one
+ */
+void array_unset(array_t *a, const char *key, size_t index)
+{
+	size_t i, j, home;
+
+	if (a->assoc && a->slots_cap != 0)
+	{
+		i = key_slot(a, key);
+		if (a->slots[i] == 0)
+			return;
+		index = a->slots[i] - 1;
+		free(a->keys[index]);
+		a->keys[index] = NULL;
+		for (j = (i + 1) & (a->slots_cap - 1); a->slots[j] != 0;
+			 j = (j + 1) & (a->slots_cap - 1))
+		{
+			home = key_hash(a->keys[a->slots[j] - 1]) & (a->slots_cap - 1);
+			if ((j > i && (home <= i || home > j)) ||
+				(j < i && home <= i && home > j))
+			{
+				a->slots[i] = a->slots[j];
+				i = j;
+			}
+		}
+		a->slots[i] = 0;
+	}
+	else if (a->assoc)
+		return;
+	if (index >= a->n || a->vals[index] == NULL)
+		return;
+	free(a->vals[index]);
+	a->vals[index] = NULL;
+	a->count--;
+	while (!a->assoc && a->n > 0 && a->vals[a->n - 1] == NULL)
+		a->n--;
+}
+
+/**
+ * array_list - the values, or the keys, of the elements that are set
+ * @a: array
+ * @keys: 1 for the keys (indices of an indexed array), 0 for the values
+ *
+ * Description: values point into the array, which "${a[@]}" copies
+ * straight into argv: nothing is joined or split again.
+ *
+ * Return: NULL terminated arena array, NULL if out of memory
+ */
+char **array_list(const array_t *a, int keys)
+{
+	char **list = arena_alloc(sizeof(char *) * (a->count + 1)), num[24];
+	size_t i, n = 0;
+
+	for (i = 0; list != NULL && i < a->n; i++)
+	{
+		if (a->vals[i] == NULL)
+			continue;
+		if (!keys)
+			list[n++] = a->vals[i];
+		else if (a->assoc)
+			list[n++] = a->keys[i];
+		else
+			list[n++] = arena_strdup(num, sprintf(num, "%lu",
+												  (unsigned long)i));
+	}
+	if (list != NULL)
+		list[n] = NULL;
+	return (list);
+}
@@ -0,0 +1,212 @@
+#include "main.h"
+
+#define AST_CACHE_SIZE 64
+
+__extension__ typedef unsigned __int128 u128_t;
+
+static ast_entry_t cache[AST_CACHE_SIZE];
+static unsigned long use_counter;
+
+/**
+ * wymix - multiplies two 64-bit values and folds the 128-bit product
+ * @a: first value
+ * @b: second value
+ *
+ * Return: high half XOR low half of a * b
+ */
+static uint64_t wymix(uint64_t a, uint64_t b)
+{
+	u128_t r = (u128_t)a * b;
+
+	return ((uint64_t)r ^ (uint64_t)(r >> 64));
+}
+
+/**
+ * wymum - multiplies two 64-bit values into a 128-bit product
+ * @a: first value; receives the low half
+ * @b: second value; receives the high half
+ */
+static void wymum(uint64_t *a, uint64_t *b)
+{
+	u128_t r = (u128_t)*a * *b;
+
+	*a = (uint64_t)r;
+	*b = (uint64_t)(r >> 64);
+}
+
+/**
+ * wyr8 - reads 8 unaligned bytes
+ * @p: bytes
+ *
+ * Return: value, in host byte order
+ */
+static uint64_t wyr8(const unsigned char *p)
+{
+	uint64_t v;
+
+	memcpy(&v, p, 8);
+	return (v);
+}
+
+/**
+ * wyr4 - reads 4 unaligned bytes
+ * @p: bytes
+ *
+ * Return: value, in host byte order
+ */
+static uint64_t wyr4(const unsigned char *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, 4);
+	return (v);
+}
+
+/**
+ * wyhash - hashes a byte string (wyhash, final version 4, seed 0)
+ * @key: bytes
+ * @len: number of bytes
+ *
+ * Return: 64-bit hash
+ */
+static uint64_t wyhash(const void *key, size_t len)
+{
+	static const uint64_t s[4] = {0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull,
+								  0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull};
+	const unsigned char *p = key;
+	uint64_t seed = wymix(s[0], s[1]), a, b, see1, see2;
+	size_t i = len;
+
+	if (len <= 16)
+	{
+		if (len >= 4)
+		{
+			a = (wyr4(p) << 32) | wyr4(p + ((len >> 3) << 2));
+			b = (wyr4(p + len - 4) << 32) | wyr4(p + len - 4 - ((len >> 3) << 2));
+		}
+		else
+		{
+			a = len > 0 ? ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) |
+				p[len - 1] : 0;
+			b = 0;
+		}
+	}
+	else
+	{
+		if (i > 48)
+		{
+			see1 = seed;
+			see2 = seed;
+			do {
+				seed = wymix(wyr8(p) ^ s[1], wyr8(p + 8) ^ seed);
+				see1 = wymix(wyr8(p + 16) ^ s[2], wyr8(p + 24) ^ see1);
+				see2 = wymix(wyr8(p + 32) ^ s[3], wyr8(p + 40) ^ see2);
+				p += 48;
+				i -= 48;
+			} while (i > 48);
+			seed ^= see1 ^ see2;
+		}
+		while (i > 16)
+		{
+			seed = wymix(wyr8(p) ^ s[1], wyr8(p + 8) ^ seed);
+			i -= 16;
+			p += 16;
+		}
+		a = wyr8(p + i - 16);
+		b = wyr8(p + i - 8);
+	}
+	a ^= s[1];
+	b ^= seed;
+	wymum(&a, &b);
+	return (wymix(a ^ s[0] ^ len, b ^ s[1]));
+}
+
+/**
+ * ast_cache_lookup - finds the parse of a line seen before
+ * @line: command line
+ *
+ * Description: the entry is marked busy until ast_cache_release(), so a
+ * nested runLine() (a $(...) run in-process) can't evict the tree that
+ * is being run.
+ *
+ * Return: the entry, NULL on a miss
+ */
+ast_entry_t *ast_cache_lookup(const char *line)
+{
+	size_t len = _strlen(line);
+	uint64_t hash = wyhash(line, len);
+	int i;
+
+	for (i = 0; i < AST_CACHE_SIZE; i++)
+		if (cache[i].tree != NULL && cache[i].hash == hash &&
+			cache[i].len == len && memcmp(cache[i].line, line, len) == 0)
+		{
+			cache[i].used = ++use_counter;
+			cache[i].busy++;
+			return (&cache[i]);
+		}
+	return (NULL);
+}
+
+/**
+ * ast_cache_insert - stores a freshly parsed line
+ * @line: command line the tokens point into
+ * @tokens: tokens from lex_line()
+ * @ntok: number of tokens
+ * @tree: AST from parse_tokens()
+ *
+ * Description: on success the cache owns @tokens and @tree (the tokens
+ * are moved onto its own copy of the line) and the entry is busy, as
+ * after ast_cache_lookup(). Lines with here-documents are not cached:
+ * their bodies come from the input and differ each time.
+ *
+ * Return: the entry, NULL if the line was not cached (caller still
+ * owns @tokens and @tree)
+ */
+ast_entry_t *ast_cache_insert(const char *line, token_t *tokens, int ntok,
+							  node_t *tree)
+{
+	ast_entry_t *e = NULL;
+	size_t len = _strlen(line);
+	char *copy;
+	int i;
+
+	for (i = 0; i < ntok; i++)
+		if (tokens[i].body != NULL)
+			return (NULL);
+	for (i = 0; i < AST_CACHE_SIZE; i++) /* a free slot, else the LRU one */
+		if (cache[i].busy == 0 && (e == NULL || cache[i].used < e->used))
+			e = &cache[i];
+	if (e == NULL)
+		return (NULL);
+	copy = malloc(len + 1);
+	if (copy == NULL)
+		return (NULL);
+	memcpy(copy, line, len + 1);
+	if (e->tree != NULL)
+	{
+		free_tree(e->tree);
+		free_tokens(e->tokens, e->ntok);
+		free(e->line);
+	}
+	for (i = 0; i <= ntok; i++)
+		tokens[i].start = copy + (tokens[i].start - line);
+	e->hash = wyhash(line, len);
+	e->line = copy;
+	e->len = len;
+	e->tokens = tokens;
+	e->ntok = ntok;
+	e->tree = tree;
+	e->used = ++use_counter;
+	e->busy = 1;
+	return (e);
+}
+
+/**
+ * ast_cache_release - ends a use started by lookup or insert
+ * @e: entry
+ */
+void ast_cache_release(ast_entry_t *e)
+{
+	e->busy--;
+}
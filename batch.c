@@ -0,0 +1,166 @@
+#include "main.h"
+
+#define ARG_HEADROOM 2048 /* left free for the new process, as xargs does */
+
+/**
+ * batch_prefix - takes a leading "batch [-P jobs]" off a command
+ * @cmd: built command
+ *
+ * Description: "batch cmd args" runs cmd like "set -o autobatch" would;
+ * with -P, up to jobs batches run at the same time (-P 0: one per CPU).
+ *
+ * Return: 0 on success (also when there is no prefix), -1 on a bad -P
+ * (message printed)
+ */
+int batch_prefix(command_t *cmd)
+{
+	int skip = 1, jobs = 1, i;
+
+	if (cmd->argc == 0 || _strcmp(cmd->argv[0], "batch") != 0)
+		return (0);
+	if (cmd->argv[1] != NULL && _strcmp(cmd->argv[1], "-P") == 0)
+	{
+		if (cmd->argv[2] == NULL || !isNumber(cmd->argv[2]) ||
+			_atoi_safe(cmd->argv[2]) < 0)
+		{
+			fprintf(stderr, "%s: 1: batch: -P needs a number of jobs\n",
+					shell.name);
+			return (-1);
+		}
+		jobs = _atoi_safe(cmd->argv[2]);
+		jobs = jobs == 0 ? (int)sysconf(_SC_NPROCESSORS_ONLN) : jobs;
+		skip = 3;
+	}
+	for (i = 0; i < skip; i++)
+		cmd->argsize -= _strlen(cmd->argv[i]) + 1 + sizeof(char *);
+	cmd->argv += skip;
+	cmd->argc -= skip;
+	if (cmd->split_end <= skip) /* nothing left to split */
+		cmd->split_first = cmd->split_end = -1;
+	else
+	{
+		cmd->split_first = cmd->split_first < skip ? 0 : cmd->split_first - skip;
+		cmd->split_end -= skip;
+	}
+	cmd->batch = jobs < 1 ? 1 : jobs;
+	return (0);
+}
+
+/**
+ * arg_room - bytes execve() accepts for argv, once envp is in
+ *
+ * Return: ARG_MAX less envp's strings and pointers and some headroom
+ */
+static size_t arg_room(void)
+{
+	long max = sysconf(_SC_ARG_MAX);
+	size_t env = env_size(), limit;
+
+	limit = max > 0 ? (size_t)max : 131072;
+	return (limit > env + ARG_HEADROOM ? limit - env - ARG_HEADROOM : 0);
+}
+
+/**
+ * batch_needed - tells whether a command has to be split into batches
+ * @cmd: built and resolved command
+ *
+ * Return: 1 if batching is on for it ("batch" or "set -o autobatch"),
+ * it is external, some of its arguments can be split off and argv plus
+ * envp would not fit in ARG_MAX; 0 otherwise
+ */
+int batch_needed(const command_t *cmd)
+{
+	if (!cmd->batch && !(shell.options & OPT_AUTOBATCH))
+		return (0);
+	if (cmd->builtin || cmd->split_first == -1)
+		return (0);
+	return (cmd->argsize > arg_room());
+}
+
+/**
+ * wait_batch - waits for one batch
+ * @pid: its pid
+ *
+ * Return: its exit status, 128 + signal if it was killed
+ */
+static int wait_batch(pid_t pid)
+{
+	int status = 0;
+
+	while (waitpid(pid, &status, 0) == -1 && errno == EINTR)
+		;
+	return (WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status));
+}
+
+/**
+ * run_batched - runs a command as several commands that each fit in
+ * ARG_MAX, the way xargs would
+ * @path: full path of the command
+ * @cmd: command; its redirections are already in place
+ *
+ * Description: the arguments before and after the ones that came from
+ * multi-field words (globs, unquoted expansions) are repeated in every
+ * batch, so "cp *.txt dir/" keeps its destination. Each batch takes as
+ * many of the split arguments as fit; up to cmd->batch of them run at
+ * a time, the oldest being waited for first.
+ *
+ * Return: the highest exit status of the batches
+ */
+int run_batched(const char *path, command_t *cmd)
+{
+	int first = cmd->split_first, end = cmd->split_end, jobs, i, n;
+	int tail = cmd->argc - end, running = 0, oldest = 0, status = 0, st;
+	size_t room = arg_room(), fixed = cmd->argsize, size, *sizes;
+	char **argv = arena_alloc(sizeof(char *) * (cmd->argc + 1));
+	char **envp = cmd_envp(cmd);
+	pid_t *pids;
+
+	jobs = cmd->batch > 0 ? cmd->batch : 1;
+	pids = arena_alloc(sizeof(pid_t) * jobs);
+	sizes = arena_alloc(sizeof(size_t) * (end - first));
+	if (argv == NULL || pids == NULL || sizes == NULL)
+		return (1);
+	for (i = first; i < end; i++)
+	{
+		sizes[i - first] = _strlen(cmd->argv[i]) + 1 + sizeof(char *);
+		fixed -= sizes[i - first];
+	}
+	memcpy(argv, cmd->argv, sizeof(char *) * first);
+	fflush(NULL);
+	for (i = first; i < end; i = n)
+	{
+		for (n = i, size = fixed; n < end &&
+			 (n == i || size + sizes[n - first] <= room); n++)
+			size += sizes[n - first];
+		memcpy(argv + first, cmd->argv + i, sizeof(char *) * (n - i));
+		memcpy(argv + first + (n - i), cmd->argv + end,
+			   sizeof(char *) * (tail + 1));
+		if (running == jobs)
+		{
+			st = wait_batch(pids[oldest]);
+			status = st > status ? st : status;
+			oldest = (oldest + 1) % jobs;
+			running--;
+		}
+		pids[(oldest + running) % jobs] = fork();
+		if (pids[(oldest + running) % jobs] == -1)
+		{
+			perror("fork");
+			status = status ? status : 1;
+			break;
+		}
+		if (pids[(oldest + running) % jobs] == 0)
+		{
+			execve(path, argv, envp);
+			perror("execve");
+			_exit(126);
+		}
+		running++;
+	}
+	for (; running > 0; running--, oldest = (oldest + 1) % jobs)
+	{
+		st = wait_batch(pids[oldest]);
+		status = st > status ? st : status;
+	}
+	return (status);
+}
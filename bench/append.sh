@@ -0,0 +1,52 @@
+#!/bin/bash
+
+# Time to build a variable with 100k appends (s="$s item" on 100k lines),
+# against 10k appends.
+#
+# Target: appending stays linear, i.e. 10x the appends take at most 20x
+# the time, and the 100k run finishes within 1 second.
+# Usage: ./bench/append.sh [items]   (run from the repository root)
+
+ITEMS=${1:-100000}
+HSH=./hsh
+RATIO_TARGET=20
+ABS_TARGET_MS=1000
+
+script() {
+    echo 's='
+    for ((i = 0; i < $1; i++)); do
+        echo 's="$s item"'
+    done
+    echo 'echo ${#s}'
+}
+
+# run ITEMS: prints "length milliseconds"
+run() {
+    local file start end len
+    file=$(mktemp)
+    script "$1" > "$file"
+    start=$(date +%s%N)
+    len=$($HSH < "$file")
+    end=$(date +%s%N)
+    rm -f "$file"
+    echo "$len $(((end - start) / 1000000))"
+}
+
+read -r small_len small_ms < <(run $((ITEMS / 10)))
+read -r big_len big_ms < <(run "$ITEMS")
+
+echo "$((ITEMS / 10)) appends: ${small_len} bytes in ${small_ms}ms"
+echo "$ITEMS appends: ${big_len} bytes in ${big_ms}ms"
+
+if [ "$big_len" != $((ITEMS * 5)) ]; then
+    echo "append target: FAILED (wrong length)"
+    exit 1
+fi
+ratio=$((big_ms / (small_ms > 0 ? small_ms : 1)))
+echo "ratio: ${ratio}x (target <= ${RATIO_TARGET}x, <= ${ABS_TARGET_MS}ms)"
+
+if [ "$ratio" -gt "$RATIO_TARGET" ] || [ "$big_ms" -gt "$ABS_TARGET_MS" ]; then
+    echo "append target: FAILED"
+    exit 1
+fi
+echo "append target: PASSED"
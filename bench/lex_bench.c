@@ -0,0 +1,135 @@
+#include "../scan.c" /* the static scanners are what is measured */
+#include <time.h>
+
+/**
+ * struct impl_s - one scanner to measure
+ * @name: label printed in the results
+ * @fn: scanner
+ */
+typedef struct impl_s
+{
+	const char *name;
+	size_t (*fn)(const char *s);
+} impl_t;
+
+/**
+ * make_line - builds a command line of the given size out of arguments
+ * that look like generated file paths
+ * @size: length of the line, without the NUL
+ *
+ * Return: malloc'd line
+ */
+static char *make_line(size_t size)
+{
+	char *line = malloc(size + 1);
+	size_t i = 0;
+	int n = 0;
+
+	if (line == NULL)
+		exit(1);
+	while (i < size)
+	{
+		i += snprintf(line + i, size + 1 - i, "data/batch_%02d/item_%06d.json ",
+					  n % 100, n);
+		n++;
+	}
+	line[size] = '\0';
+	return (line);
+}
+
+/**
+ * walk - visits every token boundary of a line, as the lexer does
+ * @fn: scanner
+ * @line: command line
+ *
+ * Return: number of boundaries found
+ */
+static size_t walk(size_t (*fn)(const char *s), const char *line)
+{
+	const char *p = line;
+	size_t n = 0;
+
+	while (*p)
+	{
+		p += fn(p);
+		if (*p)
+			p++;
+		n++;
+	}
+	return (n);
+}
+
+/**
+ * check - compares a scanner with the scalar one at every byte value
+ * and every alignment
+ * @impl: scanner
+ *
+ * Return: 0 if they agree, 1 otherwise
+ */
+static int check(const impl_t *impl)
+{
+	char buf[128];
+	int c, off, at;
+
+	for (c = 1; c < 256; c++)
+		for (off = 0; off < 32; off++)
+			for (at = 0; at < 64; at++)
+			{
+				memset(buf, 'a', sizeof(buf));
+				buf[off + at] = (char)c;
+				buf[off + 80] = '\0';
+				if (impl->fn(buf + off) != scan_scalar(buf + off))
+				{
+					printf("%s: mismatch for byte 0x%02x\n", impl->name, c);
+					return (1);
+				}
+			}
+	return (0);
+}
+
+/**
+ * main - times scan_plain()'s implementations on 1 KB, 64 KB and 1 MB lines
+ *
+ * Description: prints MB/s per implementation and size; each line is
+ * walked boundary by boundary, so the per-call cost of the vector code
+ * is part of the figure.
+ *
+ * Return: 0 on success, 1 if an implementation disagrees with the scalar one
+ */
+int main(void)
+{
+	impl_t impls[3] = {{"scalar", scan_scalar}, {NULL, NULL}, {NULL, NULL}};
+	size_t sizes[] = {1024, 65536, 1048576}, bytes, n = 0;
+	struct timespec t0, t1;
+	int i, s, nimpl = 1, reps;
+	double secs;
+	char *line;
+
+	scan_resolve(""); /* fills the scalar table */
+#ifdef SCAN_X86
+	if (__builtin_cpu_supports("ssse3"))
+		impls[nimpl++] = (impl_t){"ssse3", scan_ssse3};
+	if (__builtin_cpu_supports("avx2"))
+		impls[nimpl++] = (impl_t){"avx2", scan_avx2};
+#endif
+	for (i = 1; i < nimpl; i++)
+		if (check(&impls[i]))
+			return (1);
+	for (s = 0; s < 3; s++)
+	{
+		line = make_line(sizes[s]);
+		reps = (int)(256 * 1048576 / sizes[s]);
+		for (i = 0; i < nimpl; i++)
+		{
+			clock_gettime(CLOCK_MONOTONIC, &t0);
+			for (bytes = 0; bytes < (size_t)reps * sizes[s]; bytes += sizes[s])
+				n += walk(impls[i].fn, line);
+			clock_gettime(CLOCK_MONOTONIC, &t1);
+			secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+			printf("%7zu-byte line  %-6s %8.0f MB/s\n", sizes[s],
+				   impls[i].name, bytes / secs / 1048576);
+		}
+		free(line);
+	}
+	return (n == 0);
+}
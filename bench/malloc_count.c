@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/*
+ * Linked into hsh-malloc-count with -Wl,--wrap=malloc,--wrap=realloc,
+ * --wrap=calloc: every allocation the shell's own code makes goes
+ * through here and is counted. The count is printed to stderr when the
+ * shell exits (children that exit on their own are not reported).
+ */
+
+void *__real_malloc(size_t size);
+void *__real_realloc(void *p, size_t size);
+void *__real_calloc(size_t n, size_t size);
+
+static unsigned long allocations;
+static pid_t shell_pid;
+
+/**
+ * __wrap_malloc - counts a malloc() call
+ * @size: bytes
+ *
+ * Return: what malloc() returned
+ */
+void *__wrap_malloc(size_t size)
+{
+	allocations++;
+	return (__real_malloc(size));
+}
+
+/**
+ * __wrap_realloc - counts a realloc() call
+ * @p: block
+ * @size: bytes
+ *
+ * Return: what realloc() returned
+ */
+void *__wrap_realloc(void *p, size_t size)
+{
+	allocations++;
+	return (__real_realloc(p, size));
+}
+
+/**
+ * __wrap_calloc - counts a calloc() call
+ * @n: elements
+ * @size: bytes per element
+ *
+ * Return: what calloc() returned
+ */
+void *__wrap_calloc(size_t n, size_t size)
+{
+	allocations++;
+	return (__real_calloc(n, size));
+}
+
+/**
+ * start - remembers which process is the shell
+ */
+__attribute__((constructor)) static void start(void)
+{
+	shell_pid = getpid();
+}
+
+/**
+ * report - prints the number of allocations at exit
+ */
+__attribute__((destructor)) static void report(void)
+{
+	if (getpid() == shell_pid)
+		fprintf(stderr, "hsh: allocations: %lu\n", allocations);
+}
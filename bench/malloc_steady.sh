@@ -0,0 +1,34 @@
+#!/bin/bash
+
+# Proves that repeated command lines make no malloc() calls: runs the
+# same block of lines 10 and 110 times through hsh-malloc-count (the
+# shell linked with bench/malloc_count.c) and checks that the number of
+# allocations does not change.
+# Usage: ./bench/malloc_steady.sh   (run from the repository root)
+
+HSH=./hsh-malloc-count
+BLOCK='echo steady > /dev/null
+true a "b c" '"'"'d'"'"' && : || false
+echo one two | cat > /dev/null
+/bin/true arg1 arg2 2>/dev/null
+echo $(echo in-process) x`echo y` >> /dev/null
+echo ${HOME##*/} ${HOME%/*} ${HOME/o/0} ${HOME:1:2} ${unset:-x} > /dev/null'
+
+script() {
+    for ((i = 0; i < $1; i++)); do
+        printf '%s\n' "$BLOCK"
+    done
+}
+
+count() {
+    script "$1" | $HSH 2>&1 >/dev/null | sed -n 's/^hsh: allocations: //p'
+}
+
+few=$(count 10)
+many=$(count 110)
+echo "allocations after 10 blocks: $few, after 110 blocks: $many"
+if [ -z "$few" ] || [ "$few" != "$many" ]; then
+    echo "FAIL: steady-state lines allocate"
+    exit 1
+fi
+echo "PASS: no allocations in steady state"
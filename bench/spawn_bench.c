@@ -0,0 +1,67 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <time.h>
+
+extern char **environ;
+
+/**
+ * cmp_long - qsort comparator for longs
+ * @a: first element
+ * @b: second element
+ *
+ * Return: <0, 0 or >0
+ */
+static int cmp_long(const void *a, const void *b)
+{
+	long x = *(const long *)a, y = *(const long *)b;
+
+	return ((x > y) - (x < y));
+}
+
+/**
+ * main - spawns a command N times and reports its wall-clock latency
+ * @argc: number of arguments
+ * @argv: "spawn_bench N cmd [args...]"
+ *
+ * Description: prints "median_us mean_us" for one spawn+wait round trip.
+ * posix_spawn keeps the harness's own cost out of the numbers.
+ *
+ * Return: 0 on success, 1 on usage or spawn error
+ */
+int main(int argc, char *argv[])
+{
+	struct timespec t0, t1;
+	long *samples, total = 0;
+	int runs, i, status;
+	pid_t pid;
+
+	if (argc < 3 || (runs = atoi(argv[1])) <= 0)
+	{
+		fprintf(stderr, "usage: %s N cmd [args...]\n", argv[0]);
+		return (1);
+	}
+	samples = malloc(sizeof(*samples) * runs);
+	if (samples == NULL)
+		return (1);
+	for (i = 0; i < runs; i++)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		if (posix_spawn(&pid, argv[2], NULL, NULL, argv + 2, environ) != 0)
+		{
+			perror(argv[2]);
+			free(samples);
+			return (1);
+		}
+		waitpid(pid, &status, 0);
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		samples[i] = (t1.tv_sec - t0.tv_sec) * 1000000L +
+					 (t1.tv_nsec - t0.tv_nsec) / 1000;
+		total += samples[i];
+	}
+	qsort(samples, runs, sizeof(*samples), cmp_long);
+	printf("%ld %ld\n", samples[runs / 2], total / runs);
+	free(samples);
+	return (0);
+}
@@ -0,0 +1,34 @@
+#!/bin/bash
+
+# Startup latency of "hsh -c true" compared to "dash -c true".
+#
+# Target: the median hsh round trip stays within 1.5x of dash's median
+# (and under 2 ms), since other tools spawn hsh as a subprocess.
+# Usage: ./bench/startup.sh [runs]   (run from the repository root)
+
+RUNS=${1:-2000}
+BENCH=./bench/spawn_bench
+RATIO_TARGET=150   # percent of dash's median
+ABS_TARGET_US=2000
+
+DASH=$(command -v dash)
+if [ -z "$DASH" ]; then
+    echo "dash not found; skipping comparison"
+    exit 0
+fi
+
+read -r hsh_median hsh_mean < <($BENCH "$RUNS" ./hsh -c true)
+read -r dash_median dash_mean < <($BENCH "$RUNS" "$DASH" -c true)
+
+echo "runs: $RUNS"
+echo "hsh  -c true: median ${hsh_median}us  mean ${hsh_mean}us"
+echo "dash -c true: median ${dash_median}us  mean ${dash_mean}us"
+
+ratio=$((hsh_median * 100 / (dash_median > 0 ? dash_median : 1)))
+echo "ratio: ${ratio}% of dash (target <= ${RATIO_TARGET}%, <= ${ABS_TARGET_US}us)"
+
+if [ "$ratio" -gt "$RATIO_TARGET" ] || [ "$hsh_median" -gt "$ABS_TARGET_US" ]; then
+    echo "startup target: FAILED"
+    exit 1
+fi
+echo "startup target: PASSED"
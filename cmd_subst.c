@@ -0,0 +1,174 @@
+#include "main.h"
+
+#define CAPTURE_CHUNK 65536
+
+/**
+ * assigns_var - tells whether a command line holds ${NAME=word} or
+ * ${NAME:=word}, which set NAME
+ * @body: command line
+ *
+ * Return: 1 if it does, 0 otherwise
+ */
+static int assigns_var(const char *body)
+{
+	const char *p = body;
+
+	while ((p = _strchr(p, '$')) != NULL)
+	{
+		if (*++p != '{')
+			continue;
+		p++;
+		while (isalnum((unsigned char)*p) || *p == '_')
+			p++;
+		if (*p == '[')
+			while (*p != '\0' && *p != ']')
+				p++;
+		p += *p == ']';
+		if (*p == '=' || (*p == ':' && p[1] == '='))
+			return (1);
+	}
+	return (0);
+}
+
+/**
+ * runs_in_process - tells whether a $(...) body can run without a fork
+ * @body: inner command line
+ *
+ * Description: true for one pure builtin (echo, true...) with no
+ * operators, redirections or nested substitutions; anything that could
+ * change shell state (cd, exit, setenv, ${x:=5}) still gets a subshell.
+ *
+ * Return: 1 if it can run in-process, 0 otherwise
+ */
+static int runs_in_process(const char *body)
+{
+	char name[32];
+	int len = 0;
+
+	if (_strcspn(body, "|&;<>()`") != (size_t)_strlen(body) ||
+		assigns_var(body))
+		return (0);
+	while (*body == ' ' || *body == '\t')
+		body++;
+	while (body[len] && body[len] != ' ' && body[len] != '\t')
+	{
+		if (len == (int)sizeof(name) - 1)
+			return (0);
+		name[len] = body[len];
+		len++;
+	}
+	name[len] = '\0';
+	return (len > 0 && isPureBuiltin(name));
+}
+
+/**
+ * capture_in_process - runs a builtin body with stdout in a memory buffer
+ * @body: inner command line
+ * @out: buffer the output is appended to
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int capture_in_process(const char *body, strbuf_t *out)
+{
+	FILE *saved = stdout, *mem;
+	char *data = NULL;
+	size_t size = 0;
+	int rtn = 0;
+
+	fflush(stdout);
+	mem = open_memstream(&data, &size);
+	if (mem == NULL)
+		return (-1);
+	stdout = mem; /* glibc allows assigning the standard streams */
+	runLine(0, body);
+	fclose(mem);
+	stdout = saved;
+	if (data != NULL && sb_append(out, data, size) == -1)
+		rtn = -1;
+	free(data);
+	return (rtn);
+}
+
+/**
+ * capture_forked - runs a body in a child and reads its stdout
+ * @body: inner command line (NUL terminated)
+ * @out: buffer the output is appended to
+ *
+ * Description: reads straight into the tail of @out in 64 KiB read()s,
+ * so the captured text is never copied a second time.
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int capture_forked(const char *body, strbuf_t *out)
+{
+	int fds[2], status = 0;
+	ssize_t n;
+	pid_t pid;
+
+	if (pipe(fds) == -1)
+	{
+		perror("pipe");
+		return (-1);
+	}
+	fflush(NULL);
+	pid = fork();
+	if (pid == -1)
+	{
+		perror("fork");
+		close(fds[0]);
+		close(fds[1]);
+		return (-1);
+	}
+	if (pid == 0)
+	{
+		close(fds[0]);
+		if (dup2(fds[1], STDOUT_FILENO) == -1)
+			_exit(EXIT_FAILURE);
+		close(fds[1]);
+		coproc_close_fds();
+		runLine(0, body);
+		childExit(shell.status);
+	}
+	close(fds[1]);
+	while (1)
+	{
+		if (sb_reserve(out, CAPTURE_CHUNK) == -1)
+			break;
+		n = read(fds[0], out->data + out->len, out->cap - out->len - 1);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		out->len += n;
+	}
+	close(fds[0]);
+	waitpid(pid, &status, 0);
+	shell.status = WIFEXITED(status) ? WEXITSTATUS(status)
+									 : 128 + WTERMSIG(status);
+	return (0);
+}
+
+/**
+ * command_substitute - runs the body of a $(...) or `...` and appends its
+ * output, minus trailing newlines
+ * @body: inner command line (NUL terminated)
+ * @out: buffer the output is appended to
+ *
+ * Return: 0 on success, -1 on error
+ */
+int command_substitute(const char *body, strbuf_t *out)
+{
+	size_t start = out->len;
+	int rtn;
+
+	if (runs_in_process(body))
+		rtn = capture_in_process(body, out);
+	else
+		rtn = capture_forked(body, out);
+	shell.subst_status = shell.status;
+	while (out->len > start && out->data[out->len - 1] == '\n')
+		out->len--; /* trailing newlines are stripped in place */
+	if (out->data != NULL)
+		out->data[out->len] = '\0';
+	return (rtn);
+}
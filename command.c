@@ -0,0 +1,501 @@
+#include "main.h"
+
+/**
+ * push - appends one element to a growable array
+ * @arr: address of the array
+ * @count: address of the element count
+ * @cap: address of the capacity, in elements
+ * @size: size of one element
+ * @elem: element to copy in
+ *
+ * Return: 0 on success, -1 if out of memory
+ */
+static int push(void *arr, int *count, int *cap, size_t size, const void *elem)
+{
+	void **a = arr, *tmp;
+
+	if (*count + 1 >= *cap) /* keeps a free slot for argv's NULL */
+	{
+		tmp = arena_realloc(*a, size * *cap, size * (*cap * 2));
+		if (tmp == NULL)
+			return (-1);
+		*a = tmp;
+		*cap *= 2;
+	}
+	memcpy((char *)*a + size * (*count)++, elem, size);
+	return (0);
+}
+
+/**
+ * check_redirections - validates the fd operands of >&, <& and friends
+ * @cmd: built command
+ *
+ * Return: 0 if valid, -1 on error (message printed)
+ */
+static int check_redirections(command_t *cmd)
+{
+	redir_t *r;
+	int i;
+
+	for (i = 0; i < cmd->nredirs; i++)
+	{
+		r = &cmd->redirs[i];
+		if (r->op == REDIR_DUP && _strcmp(r->target, "-") == 0)
+			r->op = REDIR_CLOSE;
+		else if (r->op == REDIR_DUP && !isNumber(r->target))
+		{
+			fprintf(stderr, "%s: 1: Syntax error: Bad fd number\n", shell.name);
+			return (-1);
+		}
+	}
+	return (0);
+}
+
+/**
+ * assignment_name - tells whether a word is an assignment
+ * @w: word text, before expansion
+ * @len: its length
+ * @eq: set to the offset of its '='
+ *
+ * Return: length of NAME in NAME=value, NAME+=value,
+ * NAME[subscript]=value or NAME=(...), 0 if the word is not an
+ * assignment
+ */
+static size_t assignment_name(const char *w, size_t len, size_t *eq)
+{
+	size_t i, name;
+
+	if (len == 0 || !(isalpha((unsigned char)w[0]) || w[0] == '_'))
+		return (0);
+	for (i = 1; i < len && (isalnum((unsigned char)w[i]) || w[i] == '_');)
+		i++;
+	name = i;
+	if (i < len && w[i] == '[')
+	{
+		while (i < len && w[i] != ']')
+			i++;
+		i++;
+	}
+	else if (i + 1 < len && w[i] == '+' && w[i + 1] == '=' &&
+			 (i + 2 == len || w[i + 2] != '('))
+		i++;
+	if (i >= len || w[i] != '=')
+		return (0);
+	*eq = i;
+	return (name);
+}
+
+/**
+ * self_reference - measures a $NAME or ${NAME} at the start of the
+ * value of NAME=value
+ * @w: assignment word
+ * @name: length of NAME
+ * @v: start of the value, after any opening double quote
+ * @end: end of the word
+ *
+ * Return: length of the reference, 0 if the value does not start with
+ * one to NAME itself
+ */
+static size_t self_reference(const char *w, size_t name, const char *v,
+							 const char *end)
+{
+	if (v + name + 1 > end || *v != '$')
+		return (0);
+	if (v[1] == '{' && v + name + 3 <= end && v[name + 2] == '}' &&
+		memcmp(v + 2, w, name) == 0)
+		return (name + 3);
+	if (memcmp(v + 1, w, name) == 0 && (v + name + 1 == end ||
+		!(isalnum((unsigned char)v[name + 1]) || v[name + 1] == '_')))
+		return (name + 1);
+	return (0);
+}
+
+/**
+ * build_assign - expands a NAME=value or NAME+=value word
+ * @w: word text
+ * @len: its length
+ * @name: length of NAME
+ * @eq: offset of the '='
+ * @words: buffer "NAME=value" or "NAME+=value" is appended to
+ *
+ * Description: a value that starts with $NAME or ${NAME}, quoted or
+ * not, is an append to NAME: only the rest is expanded, and the word
+ * becomes NAME+=rest. s="$s $item" then never copies s, which
+ * var_append() grows in place.
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int build_assign(const char *w, size_t len, size_t name, size_t eq,
+						strbuf_t *words)
+{
+	const char *v = w + eq + 1, *end = w + len;
+	int dq = v < end && *v == '"', plus = eq > name;
+	size_t ref = plus ? 0 : self_reference(w, name, v + dq, end);
+	char *rest;
+
+	if (sb_append(words, w, name) == -1 ||
+		sb_append(words, plus || ref ? "+=" : "=", plus || ref ? 2 : 1) == -1)
+		return (-1);
+	if (ref == 0 || !dq)
+	{
+		v += ref;
+		return (expand_word(v, end - v, words, 0) == -1 ? -1 : 0);
+	}
+	v += 1 + ref;
+	rest = arena_alloc(end - v + 1); /* the rest, still in double quotes */
+	if (rest == NULL)
+		return (-1);
+	rest[0] = '"';
+	memcpy(rest + 1, v, end - v);
+	return (expand_word(rest, end - v + 1, words, 0) == -1 ? -1 : 0);
+}
+
+/**
+ * flatten_appends - turns the NAME+=value prefixes of a command into
+ * NAME=value, the form its environment needs
+ * @cmd: built command, with words
+ *
+ * Return: 0 on success, -1 if out of memory
+ */
+static int flatten_appends(command_t *cmd)
+{
+	size_t name, old;
+	const char *value;
+	char *entry;
+	int i;
+
+	for (i = 0; i < cmd->nassigns; i++)
+	{
+		name = _strcspn(cmd->assigns[i], "=");
+		if (name == 0 || cmd->assigns[i][name - 1] != '+')
+			continue;
+		entry = arena_strdup(cmd->assigns[i], name - 1);
+		value = entry != NULL ? _getenv(entry) : NULL;
+		old = value != NULL ? _strlen(value) : 0;
+		entry = arena_alloc(name + old + _strlen(cmd->assigns[i] + name));
+		if (entry == NULL)
+			return (-1);
+		memcpy(entry, cmd->assigns[i], name - 1);
+		entry[name - 1] = '=';
+		memcpy(entry + name, value != NULL ? value : "", old);
+		memcpy(entry + name + old, cmd->assigns[i] + name + 1,
+			   _strlen(cmd->assigns[i] + name + 1) + 1);
+		cmd->assigns[i] = entry;
+		cmd->argsize += old - 1;
+	}
+	return (0);
+}
+
+/**
+ * build_element - expands one word of a NAME=(...) list
+ * @t: the word
+ * @text: buffer the key and elements are appended to
+ * @offs: address of the element offsets array
+ * @keys: address of the key offsets array, parallel to it; (size_t)-1
+ * for an element without [key]=
+ * @n: address of the element count
+ * @cap: address of the capacities of both arrays
+ *
+ * Description: [key]=value is one element, expanded without field
+ * splitting; any other word can give several (a glob, $VAR).
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int build_element(const token_t *t, strbuf_t *text, size_t **offs,
+						 size_t **keys, int *n, int cap[2])
+{
+	const char *close = t->start[0] == '[' ? _strchr(t->start, ']') : NULL;
+	size_t key = (size_t)-1, off;
+	int nf, k, m;
+
+	if (close != NULL && close < t->start + t->len - 1 && close[1] == '=')
+	{
+		key = text->len;
+		if (expand_word(t->start + 1, close - t->start - 1, text, 0) == -1 ||
+			expand_word(close + 2, t->start + t->len - close - 2, text, 0) == -1)
+			return (-1);
+		off = key + _strlen(text->data + key) + 1;
+		m = *n;
+		return (push(offs, n, &cap[0], sizeof(size_t), &off) == -1 ||
+				push(keys, &m, &cap[1], sizeof(size_t), &key) == -1 ? -1 : 0);
+	}
+	off = text->len;
+	nf = expand_word(t->start, t->len, text, 1);
+	for (k = 0; k < nf; k++)
+	{
+		m = *n;
+		if (push(offs, n, &cap[0], sizeof(size_t), &off) == -1 ||
+			push(keys, &m, &cap[1], sizeof(size_t), &key) == -1)
+			return (-1);
+		off += _strlen(text->data + off) + 1;
+	}
+	return (nf == -1 ? -1 : 0);
+}
+
+/**
+ * build_array - expands a NAME[subscript]=value or NAME=(...) word
+ * @w: word text
+ * @len: its length
+ * @name: length of NAME
+ * @eq: offset of the '='
+ * @as: receives the assignment, in the per-line arena
+ *
+ * Description: the list of NAME=(...) is split into words by the lexer
+ * and each word is expanded like an argument.
+ *
+ * Return: 0 on success, -1 on error (message printed)
+ */
+static int build_array(const char *w, size_t len, size_t name, size_t eq,
+					   array_assign_t *as)
+{
+	strbuf_t text = {NULL, 0, 0};
+	size_t *offs = arena_alloc(sizeof(size_t) * 8), *keys;
+	int n = 0, cap[2] = {8, 8}, i, ntok, rtn = 0;
+	token_t *toks;
+	char *list;
+
+	keys = arena_alloc(sizeof(size_t) * 8);
+	as->name = arena_strdup(w, name);
+	as->subscript = as->value = NULL;
+	as->keys = as->elems = NULL;
+	as->nelems = 0;
+	if (offs == NULL || keys == NULL || as->name == NULL)
+		return (-1);
+	if (eq > name) /* NAME[subscript]=value */
+	{
+		if (expand_word(w + name + 1, eq - name - 2, &text, 0) == -1 ||
+			expand_word(w + eq + 1, len - eq - 1, &text, 0) == -1)
+			return (-1);
+		as->subscript = text.data;
+		as->value = text.data + _strlen(text.data) + 1;
+		return (0);
+	}
+	list = arena_strdup(w + eq + 2, len - eq - 3);
+	ntok = list ? lex_line(list, &toks) : -1;
+	if (ntok == -1)
+		return (-1);
+	for (i = 0; i < ntok && rtn == 0; i++)
+		if (toks[i].type == TOK_WORD)
+			rtn = build_element(&toks[i], &text, &offs, &keys, &n, cap);
+		else if (toks[i].type != TOK_NEWLINE)
+		{
+			fprintf(stderr, "%s: 1: Syntax error: \"%.*s\" unexpected\n",
+					shell.name, (int)toks[i].len, toks[i].start);
+			rtn = -1;
+		}
+	free_tokens(toks, ntok);
+	as->elems = arena_alloc(sizeof(char *) * (n + 1));
+	as->keys = arena_alloc(sizeof(char *) * (n + 1));
+	if (rtn == -1 || !as->elems || !as->keys || sb_append(&text, "", 0) == -1)
+		return (-1);
+	for (i = 0; i < n; i++)
+	{
+		as->elems[i] = text.data + offs[i];
+		as->keys[i] = keys[i] == (size_t)-1 ? NULL : text.data + keys[i];
+	}
+	as->nelems = n;
+	return (0);
+}
+
+/**
+ * build_compound - expands a NAME=(...) word that a declaration builtin
+ * got as an argument, as build_array() does for a NAME=(...) before the
+ * command name
+ * @word: word text, before expansion (see build_command())
+ * @as: receives the assignment, in the per-line arena
+ *
+ * Return: 0 on success, -1 on error (message printed)
+ */
+int build_compound(const char *word, array_assign_t *as)
+{
+	size_t len = _strlen(word), eq, name = assignment_name(word, len, &eq);
+
+	if (name == 0 || word[name] == '[' || word[eq + 1] != '(')
+		return (-1);
+	return (build_array(word, len, name, eq, as));
+}
+
+/**
+ * declaration - tells whether a word of a declare or typeset command is
+ * a NAME=(...) to be left for the builtin to expand
+ * @cmd: the command, as built so far
+ * @words: its words
+ * @offs: offsets of its argv in @words
+ * @t: the word
+ *
+ * Return: 1 if it is, 0 otherwise
+ */
+static int declaration(const command_t *cmd, const strbuf_t *words,
+					   const size_t *offs, const token_t *t)
+{
+	size_t eq, name;
+
+	if (cmd->argc == 0 || (_strcmp(words->data + offs[0], "declare") != 0 &&
+						   _strcmp(words->data + offs[0], "typeset") != 0))
+		return (0);
+	name = assignment_name(t->start, t->len, &eq);
+	return (name > 0 && t->start[name] != '[' && eq + 2 < t->len &&
+			t->start[eq + 1] == '(' && t->start[t->len - 1] == ')');
+}
+
+/**
+ * assignments_only - tells whether a command is made of assignments
+ * (and redirections) alone
+ * @n: N_COMMAND node
+ *
+ * Return: 1 if it is and has an assignment, 0 otherwise
+ */
+static int assignments_only(const node_t *n)
+{
+	size_t eq;
+	int i, any = 0;
+
+	for (i = 0; i < n->ntok; i++)
+		if (n->tok[i].type == TOK_REDIR)
+			i++;
+		else if (assignment_name(n->tok[i].start, n->tok[i].len, &eq) == 0)
+			return (0);
+		else
+			any = 1;
+	return (any);
+}
+
+/**
+ * build_command - expands a parsed simple command into argv and its
+ * redirection plan
+ * @n: N_COMMAND node
+ * @cmd: receives argv and redirections
+ * @assign: 1 to carry out a line of assignments alone as it is expanded,
+ * left to right, so "X=1 Y=$X" sees the new X; 0 in a pipeline stage,
+ * whose assignments only reach its child
+ *
+ * Description: words go through quote removal and substitutions, and
+ * unquoted substitution output is split into several words. All the
+ * resulting text lives in one buffer, cmd->words; offsets into it are
+ * collected first and turned into pointers once it stops growing.
+ * Everything is allocated from the per-line arena. The execve() size of
+ * argv is summed on the way, for batching. NAME=value words before the
+ * command name become cmd->assigns instead; their values are expanded
+ * as one field, and appends stay NAME+=value on a line of assignments
+ * alone. Array assignments go to cmd->arrays, except that a NAME=(...)
+ * argument of declare or typeset is passed on unexpanded, for the
+ * builtin to expand with build_compound(). Patterns in the words are
+ * compiled once and kept by @n.
+ *
+ * Return: 0 on success, -1 on error (message already printed)
+ */
+int build_command(node_t *n, command_t *cmd, int assign)
+{
+	node_t *outer = expand_node(n);
+	strbuf_t words = {NULL, 0, 0};
+	int cap = 16, redir_cap = 4, i, k, nf, rtn = 0;
+	size_t *offs = arena_alloc(sizeof(size_t) * cap), off, len;
+	size_t *targets = arena_alloc(sizeof(size_t) * (n->ntok / 2 + 1));
+	size_t *assigns = arena_alloc(sizeof(size_t) * (n->ntok + 1)), name, eq;
+	token_t *t;
+	redir_t r;
+
+	cmd->argc = 0;
+	cmd->nredirs = 0;
+	cmd->words = NULL;
+	cmd->argv = NULL;
+	cmd->builtin = 0;
+	cmd->path = NULL;
+	cmd->argsize = sizeof(char *); /* argv's NULL */
+	cmd->split_first = -1;
+	cmd->split_end = -1;
+	cmd->batch = 0;
+	cmd->nassigns = 0;
+	cmd->arrays = NULL;
+	cmd->narrays = 0;
+	cmd->assign_failed = 0;
+	assign = assign && assignments_only(n);
+	cmd->redirs = arena_alloc(sizeof(redir_t) * redir_cap);
+	if (!offs || !targets || !assigns || !cmd->redirs)
+		rtn = -1;
+	for (i = 0; rtn == 0 && i < n->ntok; i++)
+	{
+		t = &n->tok[i];
+		off = words.len;
+		if (t->type == TOK_REDIR)
+		{
+			r.fd = t->fd;
+			r.op = t->op;
+			r.target = t->body; /* here-document: the token keeps the body */
+			targets[cmd->nredirs] = off;
+			t = &n->tok[++i];
+			if (r.op != REDIR_HEREDOC &&
+				expand_word(t->start, t->len, &words, 0) == -1)
+				rtn = -1;
+			else
+				rtn = push(&cmd->redirs, &cmd->nredirs, &redir_cap,
+						   sizeof(redir_t), &r);
+			continue;
+		}
+		name = cmd->argc == 0 ? assignment_name(t->start, t->len, &eq) : 0;
+		if (name > 0 && (t->start[name] == '[' || (eq + 2 < t->len &&
+			t->start[eq + 1] == '(' && t->start[t->len - 1] == ')')))
+		{
+			if (cmd->arrays == NULL)
+				cmd->arrays = arena_alloc(sizeof(array_assign_t) * n->ntok);
+			if (cmd->arrays == NULL || build_array(t->start, t->len, name, eq,
+							&cmd->arrays[cmd->narrays++]) == -1)
+				rtn = -1;
+			else if (assign) /* carried out now, not kept */
+				cmd->assign_failed |= assign_array(&cmd->arrays[--cmd->narrays])
+									  == -1;
+			continue;
+		}
+		if (name > 0)
+		{
+			assigns[cmd->nassigns++] = off;
+			if (build_assign(t->start, t->len, name, eq, &words) == -1)
+				rtn = -1;
+			else if (assign)
+			{
+				cmd->assign_failed |= assign_word(words.data + off) == -1;
+				cmd->nassigns--;
+				words.len = off;
+			}
+			else /* counted as if it were one more envp entry */
+				cmd->argsize += words.len - off + sizeof(char *);
+			continue;
+		}
+		if (declaration(cmd, &words, offs, t)) /* declare -a a=(1 2) */
+			nf = sb_append(&words, t->start, t->len) == -1 ||
+				 sb_putc(&words, '\0') == -1 ? -1 : 1;
+		else
+			nf = expand_word(t->start, t->len, &words, 1);
+		if (nf > 1 && cmd->split_first == -1)
+			cmd->split_first = cmd->argc;
+		for (k = 0; k < nf && rtn == 0; k++)
+		{
+			rtn = push(&offs, &cmd->argc, &cap, sizeof(size_t), &off);
+			len = _strlen(words.data + off) + 1;
+			cmd->argsize += len + sizeof(char *);
+			off += len;
+		}
+		if (nf > 1)
+			cmd->split_end = cmd->argc;
+		rtn = nf == -1 ? -1 : rtn;
+	}
+	expand_node(outer);
+	cmd->argv = arena_alloc(sizeof(char *) * (cmd->argc + 1));
+	cmd->assigns = arena_alloc(sizeof(char *) * (cmd->nassigns + 1));
+	if (rtn == -1 || !cmd->argv || !cmd->assigns || sb_reserve(&words, 0) == -1)
+		return (-1);
+	cmd->words = words.data;
+	for (i = 0; i < cmd->argc; i++)
+		cmd->argv[i] = words.data + offs[i];
+	cmd->argv[cmd->argc] = NULL;
+	for (i = 0; i < cmd->nassigns; i++)
+		cmd->assigns[i] = words.data + assigns[i];
+	if (cmd->argc > 0 && flatten_appends(cmd) == -1)
+		return (-1);
+	for (i = 0; i < cmd->nredirs; i++)
+		if (cmd->redirs[i].op != REDIR_HEREDOC)
+			cmd->redirs[i].target = words.data + targets[i];
+	if (batch_prefix(cmd) == -1)
+		return (-1);
+	return (check_redirections(cmd));
+}
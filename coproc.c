@@ -0,0 +1,336 @@
+#include "main.h"
+
+#define MAX_COPROCS 8
+
+/**
+ * struct coproc_s - a running coprocess
+ * @name: variable prefix given to "coproc NAME", NULL if the slot is free
+ * @pid: process id, 0 once it has been reaped
+ * @rfd: shell's end for reading the coprocess's stdout ($NAME_0)
+ * @wfd: shell's end for writing to the coprocess's stdin ($NAME_1)
+ */
+typedef struct coproc_s
+{
+	char *name;
+	pid_t pid;
+	int rfd;
+	int wfd;
+} coproc_t;
+
+static coproc_t coprocs[MAX_COPROCS];
+
+/**
+ * release_coproc - closes a slot's fds and frees it
+ * @cp: coprocess slot
+ */
+static void release_coproc(coproc_t *cp)
+{
+	if (cp->rfd != -1)
+		close(cp->rfd);
+	if (cp->wfd != -1)
+		close(cp->wfd);
+	free(cp->name);
+	cp->name = NULL;
+	cp->rfd = -1;
+	cp->wfd = -1;
+}
+
+/**
+ * coproc_close_fds - closes the shell's ends of every coprocess in a
+ * forked child, so only the shell holds them
+ *
+ * Description: as in bash, coprocess fds are not available in
+ * subshells; a child that keeps a write end open would also stop the
+ * coprocess from ever seeing EOF. The pipes are close-on-exec, which
+ * covers the children that exec.
+ */
+void coproc_close_fds(void)
+{
+	int i;
+
+	for (i = 0; i < MAX_COPROCS; i++)
+	{
+		if (coprocs[i].name == NULL)
+			continue;
+		if (coprocs[i].rfd != -1)
+			close(coprocs[i].rfd);
+		if (coprocs[i].wfd != -1)
+			close(coprocs[i].wfd);
+		coprocs[i].rfd = coprocs[i].wfd = -1;
+	}
+}
+
+/**
+ * reapCoprocs - collects coprocesses that have exited, without blocking
+ *
+ * Description: the write end is closed since nobody reads it anymore;
+ * the read end stays open so the remaining output can still be drained.
+ */
+void reapCoprocs(void)
+{
+	int i, status;
+
+	for (i = 0; i < MAX_COPROCS; i++)
+	{
+		if (coprocs[i].name == NULL || coprocs[i].pid == 0)
+			continue;
+		if (waitpid(coprocs[i].pid, &status, WNOHANG) == coprocs[i].pid)
+		{
+			coprocs[i].pid = 0;
+			if (coprocs[i].wfd != -1)
+				close(coprocs[i].wfd);
+			coprocs[i].wfd = -1;
+		}
+	}
+}
+
+/**
+ * set_fd_var - sets NAME<suffix> to a number
+ * @name: variable prefix
+ * @suffix: "_0", "_1" or "_PID"
+ * @value: number to store
+ */
+static void set_fd_var(const char *name, const char *suffix, long value)
+{
+	char var[128], num[24];
+
+	snprintf(var, sizeof(var), "%s%s", name, suffix);
+	sprintf(num, "%ld", value);
+	var_set(var, num);
+}
+
+/**
+ * start_coproc - forks a pipeline with its stdin and stdout on two pipes
+ * @name: variable prefix
+ * @body: pipeline run by the coprocess
+ *
+ * Return: 0 on success, 1 on error
+ */
+static int start_coproc(const char *name, node_t *body)
+{
+	int to[2], from[2], i, slot = -1;
+	pid_t pid;
+
+	reapCoprocs();
+	for (i = 0; i < MAX_COPROCS; i++)
+	{
+		if (coprocs[i].name && _strcmp(coprocs[i].name, name) == 0)
+		{
+			if (coprocs[i].pid != 0)
+			{
+				fprintf(stderr, "%s: 1: coproc: %s: already running\n",
+						shell.name, name);
+				return (1);
+			}
+			release_coproc(&coprocs[i]); /* reuse the dead one's slot */
+		}
+		if (coprocs[i].name == NULL && slot == -1)
+			slot = i;
+	}
+	if (slot == -1)
+	{
+		fprintf(stderr, "%s: 1: coproc: too many coprocesses\n", shell.name);
+		return (1);
+	}
+	if (pipe2(to, O_CLOEXEC) == -1 || pipe2(from, O_CLOEXEC) == -1)
+	{
+		perror("pipe");
+		return (1);
+	}
+	fflush(NULL);
+	pid = fork();
+	if (pid == -1)
+	{
+		perror("fork");
+		close(to[0]);
+		close(to[1]);
+		close(from[0]);
+		close(from[1]);
+		return (1);
+	}
+	if (pid == 0)
+	{
+		for (i = 0; i < MAX_COPROCS; i++) /* other coprocesses' ends */
+			if (coprocs[i].name != NULL)
+				release_coproc(&coprocs[i]);
+		if (dup2(to[0], STDIN_FILENO) == -1 ||
+			dup2(from[1], STDOUT_FILENO) == -1)
+			_exit(EXIT_FAILURE);
+		close(to[1]); /* or the pipeline never sees EOF on its stdin */
+		close(from[0]);
+		run_node(body, 0);
+		childExit(shell.status);
+	}
+	close(to[0]);
+	close(from[1]);
+	coprocs[slot].name = _strdup(name);
+	coprocs[slot].pid = pid;
+	coprocs[slot].rfd = from[0];
+	coprocs[slot].wfd = to[1];
+	set_fd_var(name, "_0", from[0]);
+	set_fd_var(name, "_1", to[1]);
+	set_fd_var(name, "_PID", pid);
+	return (0);
+}
+
+/**
+ * run_coproc - runs a "coproc [NAME] pipeline" node
+ * @n: N_COPROC node; its token is NAME (if ntok is 1, else the NAME is
+ * COPROC, as in bash) and its left child the pipeline
+ *
+ * Description: the coprocess runs the pipeline with its stdin and stdout
+ * on pipes. The shell keeps the other ends open across commands,
+ * exposing the fd to read its output as $NAME_0, the fd to write its
+ * input as $NAME_1, and its pid as $NAME_PID; "read -u" and the
+ * ">&N"/"<&N" redirections use them, so every request reuses the same
+ * process.
+ *
+ * Return: 0 on success, 1 on error
+ */
+int run_coproc(node_t *n)
+{
+	char name[64];
+
+	if (n->ntok == 0)
+		return (start_coproc("COPROC", n->left));
+	if (n->tok->len >= sizeof(name))
+	{
+		fprintf(stderr, "%s: 1: coproc: %.*s: bad name\n", shell.name,
+				(int)n->tok->len, n->tok->start);
+		return (1);
+	}
+	memcpy(name, n->tok->start, n->tok->len);
+	name[n->tok->len] = '\0';
+	return (start_coproc(name, n->left));
+}
+
+/**
+ * read_line_fd - reads one line from fd without reading past it
+ * @fd: file descriptor
+ * @sb: buffer the line is stored in, without its newline
+ *
+ * Description: bytes are read one at a time so data after the newline
+ * stays in the pipe for the next reader.
+ *
+ * Return: 0 if a line was read, 1 on EOF, also after a final line with
+ * no newline (which is still stored in @sb)
+ */
+static int read_line_fd(int fd, strbuf_t *sb)
+{
+	char c;
+	ssize_t n;
+
+	while ((n = read(fd, &c, 1)) != 0)
+	{
+		if (n == -1)
+		{
+			if (errno == EINTR)
+				continue;
+			return (1);
+		}
+		if (c == '\n')
+			return (0);
+		if (sb_putc(sb, c) == -1)
+			return (1);
+	}
+	return (1);
+}
+
+/**
+ * take_field - cuts the next field off a line read by read
+ * @p: in: where to look; out: where the field after it starts
+ * @rest: 1 for the last NAME, which takes the rest of the line
+ * @raw: 1 for read -r
+ *
+ * Description: leading blanks are skipped; the last NAME also loses
+ * trailing ones. Unless @raw, a backslash is removed and the character
+ * after it kept as it is, so "\ " does not end a field or get trimmed.
+ *
+ * Return: the field, NUL terminated in place
+ */
+static char *take_field(char **p, int rest, int raw)
+{
+	char *src = *p + _strspn_blank(*p), *word = src, *dst = src;
+	char *keep = src;
+
+	while (*src != '\0' && (rest || (*src != ' ' && *src != '\t')))
+	{
+		if (*src == '\\' && !raw && src[1] != '\0')
+		{
+			src++;
+			*dst++ = *src++;
+			keep = dst;
+		}
+		else
+			*dst++ = *src++;
+	}
+	src += *src != '\0';
+	while (rest && dst > keep && (dst[-1] == ' ' || dst[-1] == '\t'))
+		dst--;
+	*dst = '\0';
+	*p = src;
+	return (word);
+}
+
+/**
+ * ends_escaped - tells whether a line ends with an unescaped backslash
+ * @sb: line
+ *
+ * Return: 1 if it does, 0 otherwise
+ */
+static int ends_escaped(const strbuf_t *sb)
+{
+	size_t n = 0;
+
+	while (n < sb->len && sb->data[sb->len - 1 - n] == '\\')
+		n++;
+	return (n % 2);
+}
+
+/**
+ * ifCmdRead - "read [-r] [-u fd] [NAME...]" reads a line into variables
+ * @tokens: tokenized user-input
+ *
+ * Description: words are split on blanks; the last NAME gets the rest of
+ * the line, and REPLY is used when no NAME is given. Without -r, a
+ * backslash escapes the next character and one ending the line joins
+ * the next line to it. Status is 1 at EOF, even when a final line with
+ * no newline was read (and assigned), as in sh.
+ *
+ * Return: 1
+ */
+int ifCmdRead(char **tokens)
+{
+	strbuf_t line = {NULL, 0, 0};
+	int fd = STDIN_FILENO, i = 1, raw = 0;
+	char *p, *reply[] = {"REPLY", NULL}, empty[1] = "";
+	char **names;
+
+	for (; tokens[i] != NULL && tokens[i][0] == '-'; i++)
+	{
+		if (_strcmp(tokens[i], "-u") == 0 && tokens[i + 1] != NULL &&
+			isNumber(tokens[i + 1]))
+			fd = _atoi_safe(tokens[++i]);
+		else if (_strcmp(tokens[i], "-r") == 0) /* backslashes are literal */
+			raw = 1;
+		else
+		{
+			fprintf(stderr, "%s: 1: read: Illegal option %s\n",
+					shell.name, tokens[i]);
+			shell.status = 2;
+			return (1);
+		}
+	}
+	names = tokens[i] != NULL ? tokens + i : reply;
+	fflush(stdout); /* a coprocess may be waiting for our request */
+	shell.status = read_line_fd(fd, &line);
+	while (!raw && shell.status == 0 && ends_escaped(&line))
+	{
+		line.data[--line.len] = '\0'; /* line continuation */
+		shell.status = read_line_fd(fd, &line);
+	}
+	p = line.data != NULL ? line.data : empty; /* take_field() writes */
+	for (i = 0; names[i] != NULL; i++)
+		var_set(names[i], take_field(&p, names[i + 1] == NULL, raw));
+	return (1);
+}
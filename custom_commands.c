@@ -1,775 +1,486 @@
 #include "main.h"
 
+/*
+ * The builtin table is a perfect hash laid out by the compiler: each
+ * entry sits at the slot BUILTIN_SLOT() gives for its name, so finding
+ * a name is one probe and one string compare. Two names landing on the
+ * same slot initialize it twice, which -Wextra -Werror (override-init)
+ * turns into a build error; change the multipliers if that happens.
+ */
+#define BUILTIN_SLOTS 64
+#define BUILTIN_MAX_LEN 13 /* "self-destruct" */
+#define BUILTIN_SLOT(first, last, len) \
+	(((first) * 3 + (last) * 5 + (len)) & (BUILTIN_SLOTS - 1))
+#define BUILTIN(name, first, last, run, flags) \
+	[BUILTIN_SLOT(first, last, sizeof(name) - 1)] = {name, run, flags, NULL}
+
+static const builtin_t builtins[BUILTIN_SLOTS] = {
+	BUILTIN(":", ':', ':', ifCmdTrueFalse, BI_PURE),
+	BUILTIN("cd", 'c', 'd', ifCmdCd, 0),
+	BUILTIN("declare", 'd', 'e', ifCmdDeclare, 0),
+	BUILTIN("echo", 'e', 'o', ifCmdEcho, BI_PURE),
+	BUILTIN("enable", 'e', 'e', ifCmdEnable, 0),
+	BUILTIN("env", 'e', 'v', ifCmdEnv, 0),
+	BUILTIN("exec", 'e', 'c', NULL, 0), /* run by executeIfValid() */
+	BUILTIN("exit", 'e', 't', NULL, BI_EXIT),
+	BUILTIN("export", 'e', 't', ifCmdExport, 0),
+	BUILTIN("false", 'f', 'e', ifCmdTrueFalse, BI_PURE),
+	BUILTIN("quit", 'q', 't', NULL, BI_EXIT),
+	BUILTIN("read", 'r', 'd', ifCmdRead, 0),
+	BUILTIN("self-destruct", 's', 't', ifCmdSelfDestruct, BI_EXIT),
+	BUILTIN("selfdestr", 's', 'r', ifCmdSelfDestruct, BI_EXIT),
+	BUILTIN("set", 's', 't', ifCmdSet, 0),
+	BUILTIN("setenv", 's', 'v', ifCmdSetEnv, 0),
+	BUILTIN("true", 't', 'e', ifCmdTrueFalse, BI_PURE),
+	BUILTIN("typeset", 't', 't', ifCmdDeclare, 0),
+	BUILTIN("unset", 'u', 't', ifCmdUnset, 0),
+	BUILTIN("unsetenv", 'u', 'v', ifCmdUnsetEnv, 0),
+};
+
+/**
+ * builtin_find - looks a command name up in the builtin table, then
+ * among the builtins loaded with "enable -f"
+ * @name: command name
+ *
+ * Return: its entry, NULL if it is not a builtin
+ */
+const builtin_t *builtin_find(const char *name)
+{
+	const builtin_t *b;
+	size_t len = 0;
+
+	while (len <= BUILTIN_MAX_LEN && name[len] != '\0')
+		len++;
+	if (len == 0 || len > BUILTIN_MAX_LEN)
+		return (plugin_find(name));
+	b = &builtins[BUILTIN_SLOT((unsigned char)name[0],
+							   (unsigned char)name[len - 1], len)];
+	return (b->name != NULL && _strcmp(b->name, name) == 0 ? b :
+			plugin_find(name));
+}
+
 /**
- * customCmd - check if the given input is a custom command. If so, executes it
+ * customCmd - runs a builtin
  *
  * @tokens: tokenized user-input
  * @interactive: if the shell is running in interactive mode (isAtty)
+ * @input: line the command was parsed from
  *
- * Return: 1 if it was a custom command and it was successfully executed,
- * 0 if it's not a custom command,
- * -1 on error
+ * Description: one lookup in the builtin table finds the handler; a
+ * command that is not a builtin costs that probe and nothing else.
+ *
+ * Return: what the handler returned (1 once it ran, cd's error codes,
+ * -1 on error), 0 if it's not a custom command
  */
 int customCmd(char **tokens, int interactive, char *input)
 {
-	int ifRtn;
-	/* ------------------ custom command "env" ------------------ */
-	if (ifCmdEnv(tokens))
-		return (1); /* might convert all returns to function return values */
-
-	/* ----------------- custom command "exit" ----------------- */
-
-	if (ifCmdExit(tokens, interactive, input)) /* exits with or without exit code*/
-		return (1);							   /* now it returns 1, if it exits */
-
-	/* ----------------- custom command "setenv" ----------------- */
-	if (ifCmdSetEnv(tokens))
-		return (1);
-
-	/* ----------------- custom command "unsetenv" ----------------- */
-	if (ifCmdUnsetEnv(tokens))
-		return (1);
-
-	/* ------------- custom command "self-destruct" ------------- */
-	if (ifCmdSelfDestruct(tokens) == -1)
-		return (-1);
-
-	/* ----------------- custom command "cd" ----------------- */
-	ifRtn = ifCmdCd(tokens);
-	if (ifRtn)
-		return (ifRtn);
-
-	return (0); /* indicate that the input is not a custom command */
+	const builtin_t *b = tokens[0] != NULL ? builtin_find(tokens[0]) : NULL;
+
+	if (b == NULL)
+		return (0); /* indicate that the input is not a custom command */
+	if (b->plugin != NULL)
+		return (plugin_run(b, tokens));
+	if (b->run == NULL && (b->flags & BI_EXIT))
+		return (ifCmdExit(tokens, interactive, input));
+	return (b->run != NULL ? b->run(tokens) : 0);
 }
 
 /**
  * ifCmdSelfDestruct - self destruct oscar mike golf
  * @tokens: tokenized array of user-inputs
- * Return: 0 if successful, -1 otherwise
+ * Return: -1 if selfDestruct() ever returns
  */
 int ifCmdSelfDestruct(char **tokens)
 {
-	if (tokens[0] != NULL && (_strcmp(tokens[0], "self-destruct") == 0 ||
-							  _strcmp(tokens[0], "selfdestr") == 0))
-	{
-		int countdown = 5; /* number of seconds to countdown from */
-
-		/* check if user gave any args and if it's a valid positive number */
-		if (tokens[1] != NULL && isNumber(tokens[1]) && _atoi_safe(tokens[1]) > 0)
-			countdown = _atoi_safe(tokens[1]); /* set countdown to given number */
-		/*
-		 * NOTE: I'd use abs() instead of checking if its positive, but
-		 * abs() is not an allowed function and I don't want to code it.
-		 */
-		selfDestruct(countdown); /* runs exit() when done */
-		return (-1);			 /* indicate error if selfDestruct never exits */
-	}
-	return (0);
+	int countdown = 5; /* number of seconds to countdown from */
+
+	/* check if user gave any args and if it's a valid positive number */
+	if (tokens[1] != NULL && isNumber(tokens[1]) && _atoi_safe(tokens[1]) > 0)
+		countdown = _atoi_safe(tokens[1]); /* set countdown to given number */
+	/*
+	 * NOTE: I'd use abs() instead of checking if its positive, but
+	 * abs() is not an allowed function and I don't want to code it.
+	 */
+	selfDestruct(countdown); /* runs exit() when done */
+	return (-1);			 /* indicate error if selfDestruct never exits */
 }
 
 /**
- * ifCmdExit: if user-input is "exit" or "quit"
+ * ifCmdExit: "exit" or "quit"
  * @tokens: tokenized array of user-inputs
  * @interactive: isatty() return value. 1 if interactive, 0 otherwise
  *
- * Return: 0 if the command isn't "exit" or "quit"
+ * Return: 1, if safeExit() ever returns
  */
 int ifCmdExit(char **tokens, int interactive, char *input)
 {
 	int exit_code = EXIT_SUCCESS; // Default exit code
 
-	if ((tokens != NULL) && (tokens[0] != NULL) &&
-		((_strcmp(tokens[0], "exit") == 0) || (_strcmp(tokens[0], "quit") == 0)))
-	{
-		if (tokens[1] != NULL)
-		{ // Check for an exit code argument
-			if (isNumber(tokens[1]))
-			{
-				exit_code = _atoi_safe(tokens[1]);
-				if (exit_code <= 0)
-				{
-					fprintf(stderr, "./hsh: 1: exit: Illegal number: %d\n",
-							exit_code);
-					exit_code = 2; // invalid number
-				}
-			}
-			else /* string */
+	(void)input; /* the line lives in the arena; nothing to free */
+	if (tokens[1] != NULL)
+	{ // Check for an exit code argument
+		if (isNumber(tokens[1]))
+		{
+			exit_code = _atoi_safe(tokens[1]);
+			if (exit_code <= 0)
 			{
-				fprintf(stderr, "./hsh: 1: exit: Illegal number: %s\n",
-						tokens[1]);
-				resetAll(tokens, input, NULL);
-				safeExit(2); /* exit with error if not number */
+				fprintf(stderr, "./hsh: 1: exit: Illegal number: %d\n",
+						exit_code);
+				exit_code = 2; // invalid number
 			}
 		}
-
-		if (interactive)
+		else /* string */
 		{
-			printf("%s\nThe %sGates Of Shell%s have closed. Goodbye.\n%s",
-				   CLR_YELLOW_BOLD, CLR_RED_BOLD, CLR_YELLOW_BOLD, CLR_DEFAULT);
+			fprintf(stderr, "./hsh: 1: exit: Illegal number: %s\n",
+					tokens[1]);
+			safeExit(2); /* exit with error if not number */
 		}
-		free(input);
-		free(tokens);
-		safeExit(exit_code); /* Exit with the determined code */
-		return 1;			 /* Should never reach here, but good practice */
 	}
 
-	return 0; /* Not an exit/quit command */
+	if (interactive)
+	{
+		printf("%s\nThe %sGates Of Shell%s have closed. Goodbye.\n%s",
+			   CLR_YELLOW_BOLD, CLR_RED_BOLD, CLR_YELLOW_BOLD, CLR_DEFAULT);
+	}
+	safeExit(exit_code); /* Exit with the determined code */
+	return 1;			 /* Should never reach here, but good practice */
 }
 
 /**
- * ifCmdEnv - prints env if the command is env
- * @tokens: tokenized user-input
+ * env_run - runs a command with a given environment and waits for it
+ * @tokens: command and its arguments
+ * @envp: environment
  *
- * Return: 1 if success, 0 if failure
+ * Return: its exit status, 127 if it was not found
  */
-int ifCmdEnv(char **tokens)
+static int env_run(char **tokens, char **envp)
 {
-	int i;
+	char *path = findPath(tokens[0]);
+	pid_t pid;
+	int status = 0;
 
-	if (tokens[0] != NULL && (_strcmp(tokens[0], "env") == 0))
+	if (path == NULL)
 	{
-		if (!environ)
-			return (1);
-
-		for (i = 0; environ[i] != NULL; i++)
-			printf("%s\n", environ[i]);
-		return (1); /* indicate success */
+		fprintf(stderr, "env: '%s': No such file or directory\n", tokens[0]);
+		return (127);
 	}
-	return (0); /* indicate that input is not "env" */
+	fflush(stdout);
+	pid = fork();
+	if (pid == 0)
+	{
+		execve(path, tokens, envp);
+		perror("env");
+		_exit(126);
+	}
+	free(path);
+	if (pid == -1)
+	{
+		perror("fork");
+		return (125);
+	}
+	while (waitpid(pid, &status, 0) == -1 && errno == EINTR)
+		;
+	return (WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status));
 }
 
 /**
- * ifCmdSetEnv - sets an environment variable
- * @tokens: tokenized user-inputed commands
+ * ifCmdEnv - env [-i] [-u NAME]... [NAME=value]... [command [args]]
+ * @tokens: tokenized user-input
  *
- * Return: 1 if success, 0 if not applicable, -1 if malloc failed
+ * Description: prints the environment, or runs a command with it,
+ * after the changes asked for. The shell's own environment is left
+ * alone: the changes are an env_overlay().
+ *
+ * Return: 1
  */
-int ifCmdSetEnv(char **tokens)
+int ifCmdEnv(char **tokens)
 {
-	int rtn;
-
-	if (tokens[0] != NULL && (_strcmp(tokens[0], "setenv") == 0))
+	int i = 1, n, clear = 0, nset = 0, nunset = 0;
+	char **set, **unset, **e;
+
+	for (n = 0; tokens[n] != NULL; n++)
+		;
+	set = arena_alloc(sizeof(char *) * n);
+	unset = arena_alloc(sizeof(char *) * n);
+	if (set == NULL || unset == NULL)
+		return (1);
+	for (; tokens[i] != NULL && tokens[i][0] == '-'; i++)
 	{
-		rtn = _setenv(tokens[1], tokens[2], 1);
-		if (rtn == -1) /* error occurred in _setenv */
+		if (_strcmp(tokens[i], "-i") == 0 || _strcmp(tokens[i], "-") == 0)
+			clear = 1;
+		else if (_strcmp(tokens[i], "-u") == 0 && tokens[i + 1] != NULL)
+			unset[nunset++] = tokens[++i];
+		else if (_strcmp(tokens[i], "--") == 0)
 		{
-			fprintf(stderr, "error: ");
-			perror(NULL);
-			return (-1);
+			i++;
+			break;
 		}
-		else if (rtn == 0) /* success */
+		else
+		{
+			fprintf(stderr, "env: invalid option '%s'\n", tokens[i]);
+			shell.status = 125;
 			return (1);
+		}
 	}
-	return (0); /* not setenv */
+	for (; tokens[i] != NULL && _strchr(tokens[i], '=') > tokens[i]; i++)
+		set[nset++] = tokens[i];
+	e = env_overlay(clear, set, nset, unset, nunset);
+	if (tokens[i] != NULL)
+	{
+		shell.status = env_run(tokens + i, e);
+		return (1);
+	}
+	for (; e != NULL && *e != NULL; e++)
+		printf("%s\n", *e);
+	return (1);
 }
 
 /**
- * ifCmdCd - changes directory
- * @tokens: tokenized array of user-input
+ * ifCmdEcho - prints its arguments separated by spaces
+ * @tokens: tokenized user-input; "-n" as first argument drops the newline
  *
- * Return: 1 if successful, 0 if not applicable, 3 too many arguments, otherwise error
+ * Return: 1
  */
-int ifCmdCd(char **tokens)
+int ifCmdEcho(char **tokens)
 {
-	char cwd_buf[PATH_MAX], abs_path[PATH_MAX + 2];
-	char *previous_cwd = _getenv("OLDPWD"); /* track previous cwd for '-' handling */
-	int chdir_rtn = 0, error_msg = 0;
-	char *home = _getenv("HOME");
-	char *pwd = _getenv("PWD");
+	int i = 1, newline = 1;
 
-	if (getcwd(cwd_buf, PATH_MAX) == NULL)
+	if (tokens[1] != NULL && _strcmp(tokens[1], "-n") == 0)
 	{
-		freeIfCmdCd(previous_cwd, home, pwd); /* frees malloc'd strings */
-		perror("getcwd");
-		return (-1);
+		newline = 0;
+		i++;
 	}
-
-	if (!pwd) /* set PWD if not already set */
-		_setenv("PWD", cwd_buf, 1);
-	else
+	for (; tokens[i] != NULL; i++)
 	{
-		free(pwd);
-		pwd = NULL;
+		fputs(tokens[i], stdout);
+		if (tokens[i + 1] != NULL)
+			putchar(' ');
 	}
+	if (newline)
+		putchar('\n');
+	return (1);
+}
 
-	if ((tokens[0] != NULL) && (_strcmp(tokens[0], "cd") == 0)) /* cd command found */
-	{
-		if (tokens[2] != NULL) /* too many arguments */
-			error_msg = 3;
-		else if (tokens[1] != NULL)
-		{
-			if (_strcmp(tokens[1], "~") == 0) /* is home */
-			{
-				if (home)
-				{
-					chdir_rtn = chdir(home);
-					if (chdir_rtn == -1)
-						error_msg = 1;
-					free(home);
-					home = NULL;
-				}
-				else
-					error_msg = 0;
-			}
-			else if (_strcmp(tokens[1], "-") == 0) /* is previous path */
-				if (previous_cwd)
-				{
-					chdir_rtn = chdir(previous_cwd);
-					if (chdir_rtn == -1)
-						printf("%s\n", _getenv("PWD"));
-					else
-						printf("%s\n", previous_cwd);
-					free(previous_cwd);
-					previous_cwd = NULL;
-				}
-				else
-					printf("%s\n", cwd_buf);
-			// else if ((_strncmp(tokens[1], "/root", 5) == 0) && (access(tokens[1], X_OK) != 0))
-			else if (access(tokens[1], X_OK) != 0) /* not permission */
-			{
-				// printf("\nNOT PERMISSION\n\n");
-				error_msg = 2;
-			}
-			else if (is_directory(tokens[1]) == 0) /* is not a directory */
-			{
-				// printf("\nNOT DIRECTORY\n\n");
-				error_msg = 4;
-			}
-			else if (tokens[1][0] == '/') /* is absolute path */
-			{
-				chdir_rtn = chdir(tokens[1]);
-				if (chdir_rtn == -1)
-					error_msg = 1;
-			}
-			else /* relative path */
-			{
-				_build_path(cwd_buf, tokens[1], abs_path);
-				chdir_rtn = chdir(abs_path);
-				if (chdir_rtn == -1)
-					error_msg = 1;
-			}
-		}
-		else /* default go $HOME */
-		{
-			if (home)
-			{
-				chdir_rtn = chdir(home);
-				free(home);
-				home = NULL;
-			}
-			else
-				error_msg = 0;
-		}
-		if ((chdir_rtn == -1) || (error_msg > 0)) /* chdir failed or custom error */
-		{
-			if ((error_msg == 1) || (error_msg == 4))
-				printf("%s\n", cwd_buf);
-
-			freeIfCmdCd(previous_cwd, home, pwd);
-			if (chdir_rtn == -1)
-				return (-1);
-			if ((error_msg == 1) || (error_msg == 4))
-				return (1);
-			if (error_msg == 2)
-				return (2);
-			if (error_msg == 3)
-				return (3); /* custom error */
-			return (0);		/* consider return errno */
-		}
-		else /* on success set OLD PWD and PWD */
-		{
-			_setenv("OLDPWD", cwd_buf, 1);
+/**
+ * isBuiltin - tells whether customCmd() would handle a command
+ * @name: command name
+ *
+ * Return: 1 if name is a builtin, 0 otherwise
+ */
+int isBuiltin(const char *name)
+{
+	return (builtin_find(name) != NULL);
+}
 
-			if (getcwd(cwd_buf, PATH_MAX) == NULL)
-			{
-				freeIfCmdCd(previous_cwd, home, pwd);
-				perror("getcwd");
-				return (-1);
-			}
-			_setenv("PWD", cwd_buf, 1);
-		}
-	}
-	else
-	{
-		freeIfCmdCd(previous_cwd, home, pwd);
-		return (0); /* cd not applicable */
-	}
+/**
+ * isPureBuiltin - tells whether a builtin only writes to stdout and never
+ * changes shell state, so it can run in-process inside $(...)
+ * @name: command name
+ *
+ * Return: 1 if pure, 0 otherwise
+ */
+int isPureBuiltin(const char *name)
+{
+	const builtin_t *b = builtin_find(name);
 
-	freeIfCmdCd(previous_cwd, home, pwd);
-	return (1); /* success */
+	return (b != NULL && (b->flags & BI_PURE));
 }
 
-int RightDirect(char *line)
+/**
+ * ifCmdTrueFalse - "true" and ":" succeed, "false" fails, without a fork
+ * @tokens: tokenized user-input
+ *
+ * Return: 1
+ */
+int ifCmdTrueFalse(char **tokens)
 {
-	int fd, i = 0, j = 0, position = 0;
-	char *filename;
-	char *args[100];
-	int bufsize = 64;
-	char **tokens = malloc(bufsize * sizeof(char *));
-	char *token;
+	if (_strcmp(tokens[0], "false") == 0)
+		shell.status = 1;
+	return (1); /* true and ":": status already 0 */
+}
 
-	if (!tokens)
-	{ /* Stanard Malloc Error Handling */
-		fprintf(stderr, "hsh: allocation error\n");
-		exit(EXIT_FAILURE);
-	}
-	token = strtok(line, " \t\r\n\a"); /* Tokenize the input */
-	while (token != NULL)
-	{
-		char *marker = _strchr(token, '>'); /* Find the first occurrence of > and set it to variable marker */
-		if (marker)
-		{					/* If > is found in the input */
-			*marker = '\0'; /* Split the token at > */
-			if (*token != '\0')
-			{								/* If there is something before > */
-				tokens[position++] = token; /* Add the token before > */
-			}
-			tokens[position++] = ">"; /* Add > to the tokens */
-			if (*(marker + 1) != '\0')
-			{									 /* If there is something after > */
-				tokens[position++] = marker + 1; /* Get rid of the space */
-			}
-		}
-		else
-		{
-			tokens[position++] = token; /* Add the token to the tokens */
-		}
-		if (position >= bufsize)
-		{														/* If the buffer is full */
-			bufsize += 64;										/* Increase the buffer size */
-			tokens = realloc(tokens, bufsize * sizeof(char *)); /* Reallocate the buffer */
-			if (!tokens)
-			{
-				fprintf(stderr, "hsh: allocation error\n");
-				exit(EXIT_FAILURE);
-			}
-		}
-		token = strtok(NULL, " \t\r\n\a"); /* Get the next token */
-	}
-	tokens[position] = NULL; /* Add NULL to the end of the tokens */
-	while (tokens[i] != NULL)
+/**
+ * ifCmdSet - "set -o NAME" turns an option on, "set +o NAME" turns it
+ * off, "set -o" alone lists every option and "set" alone every variable
+ * @tokens: tokenized user-input
+ *
+ * Return: 1
+ */
+int ifCmdSet(char **tokens)
+{
+	static const struct
 	{
-		if (_strcmp(tokens[i], ">") == 0)
-			break;			   /* If > is found in the tokens */
-		args[j++] = tokens[i]; /* Add the token to the args */
-		i++;
-	}
-	args[j] = NULL; /* Add NULL to the end of the args */
-	if (tokens[i] == NULL || tokens[i + 1] == NULL)
-	{ /* If there is no filename after > */
-		fprintf(stderr, "Syntax error: Missing filename after '>'\n");
-		free(tokens);
-		return -1;
-	}
+		const char *name;
+		int flag;
+	} options[] = {{"appendcache", OPT_APPENDCACHE},
+				   {"autobatch", OPT_AUTOBATCH}, {NULL, 0}};
+	int i, j, on;
 
-	filename = tokens[i + 1];								 /* Get the filename */
-	fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644); /* Open the file for writing */
-	if (fd == -1)
+	if (tokens[1] == NULL)
 	{
-		perror("open");
-		free(tokens);
-		return -1;
+		print_vars(var_entries(), "");
+		return (1);
 	}
-	pid_t pid = fork(); /* Fork a new process */
-	if (pid == -1)
+	if (_strcmp(tokens[1], "-o") == 0 && !tokens[2])
 	{
-		perror("fork");
-		close(fd);
-		free(tokens);
-		return -1;
+		for (j = 0; options[j].name != NULL; j++)
+			printf("%-16s%s\n", options[j].name,
+				   (shell.options & options[j].flag) ? "on" : "off");
+		return (1);
 	}
-	if (pid == 0)
+	for (i = 1; tokens[i] != NULL; i += 2)
 	{
-		if (dup2(fd, STDOUT_FILENO) == -1)
-		{ /* Redirect stdout to the file */
-			perror("dup2");
-			close(fd);
-			free(tokens);
-			exit(1);
-		}
-		close(fd);
-		if (execvp(args[0], args) == -1)
+		on = _strcmp(tokens[i], "-o") == 0;
+		for (j = 0; tokens[i + 1] != NULL && options[j].name != NULL; j++)
+			if (_strcmp(tokens[i + 1], options[j].name) == 0)
+				break;
+		if ((!on && _strcmp(tokens[i], "+o") != 0) || tokens[i + 1] == NULL ||
+			options[j].name == NULL)
 		{
-			fprintf(stderr, "./hsh: %d: %s: not found\n", 1, args[0]);
-			free(tokens);
-			exit(1);
+			fprintf(stderr, "%s: 1: set: Illegal option %s %s\n", shell.name,
+					tokens[i], tokens[i + 1] ? tokens[i + 1] : "");
+			shell.status = 2;
+			return (1);
 		}
-		execvp(args[0], args);
-		perror("execvp");
-		free(tokens);
-		exit(1);
-	}
-	else
-	{
-		close(fd);
-		wait(NULL);
+		if (on)
+			shell.options |= options[j].flag;
+		else
+			shell.options &= ~options[j].flag;
 	}
-	free(tokens);
-	return 1;
+	if (!(shell.options & OPT_APPENDCACHE))
+		append_cache_flush();
+	return (1);
 }
 
-int DoubleRightDirect(char *line)
+/**
+ * ifCmdSetEnv - sets an environment variable
+ * @tokens: tokenized user-inputed commands
+ *
+ * Return: 1 if success, -1 if malloc failed
+ */
+int ifCmdSetEnv(char **tokens)
 {
-	int fd, i = 0, j = 0, position = 0;
-	char *filename;
-	char *args[100];
-	int bufsize = 64;
-	char **tokens = malloc(bufsize * sizeof(char *));
-	char *token;
-
-	if (!tokens)
-	{ /* Stanard Malloc Error Handling */
-		fprintf(stderr, "hsh: allocation error\n");
-		exit(EXIT_FAILURE);
-	}
-	token = strtok(line, " \t\r\n\a"); /* Tokenize the input */
-	while (token != NULL)
-	{
-		char *marker = _strstr(token, ">>"); /* Find the first occurrence of > and set it to variable marker */
-		if (marker)
-		{					/* If > is found in the input */
-			*marker = '\0'; /* Split the token at > */
-			if (*token != '\0')
-			{								/* If there is something before > */
-				tokens[position++] = token; /* Add the token before > */
-			}
-			tokens[position++] = ">>"; /* Add > to the tokens */
-			if (*(marker + 2) != '\0')
-			{									 /* If there is something after > */
-				tokens[position++] = marker + 2; /* Get rid of the space */
-			}
-		}
-		else
-		{
-			tokens[position++] = token; /* Add the token to the tokens */
-		}
-		if (position >= bufsize)
-		{														/* If the buffer is full */
-			bufsize += 64;										/* Increase the buffer size */
-			tokens = realloc(tokens, bufsize * sizeof(char *)); /* Reallocate the buffer */
-			if (!tokens)
-			{
-				fprintf(stderr, "hsh: allocation error\n");
-				exit(EXIT_FAILURE);
-			}
-		}
-		token = strtok(NULL, " \t\r\n\a"); /* Get the next token */
-	}
-	tokens[position] = NULL; /* Add NULL to the end of the tokens */
-	while (tokens[i] != NULL)
-	{
-		if (_strcmp(tokens[i], ">>") == 0)
-			break;			   /* If > is found in the tokens */
-		args[j++] = tokens[i]; /* Add the token to the args */
-		i++;
-	}
-	args[j] = NULL; /* Add NULL to the end of the args */
-	if (tokens[i] == NULL || tokens[i + 1] == NULL)
-	{ /* If there is no filename after > */
-		fprintf(stderr, "Syntax error: Missing filename after '>>'\n");
-		free(tokens);
-		return -1;
-	}
-
-	filename = tokens[i + 1];								  /* Get the filename */
-	fd = open(filename, O_WRONLY | O_CREAT | O_APPEND, 0644); /* Open the file for writing */
-	if (fd == -1)
+	if (_setenv(tokens[1], tokens[2], 1) == -1) /* error occurred in _setenv */
 	{
-		perror("open");
-		free(tokens);
-		return -1;
-	}
-	pid_t pid = fork(); /* Fork a new process */
-	if (pid == -1)
-	{
-		perror("fork");
-		close(fd);
-		free(tokens);
-		return -1;
-	}
-	if (pid == 0)
-	{
-		if (dup2(fd, STDOUT_FILENO) == -1)
-		{ /* Redirect stdout to the file */
-			perror("dup2");
-			close(fd);
-			free(tokens);
-			exit(1);
-		}
-		close(fd);
-		if (execvp(args[0], args) == -1)
-		{
-			fprintf(stderr, "./hsh: %d: %s: not found\n", 1, args[0]);
-			for (int k = 0; k < position; k++)
-				free(tokens[k]);
-			free(tokens);
-			exit(127);
-		}
-		perror("execvp");
-		free(tokens);
-		exit(1);
-	}
-	else
-	{
-		close(fd);
-		wait(NULL);
+		fprintf(stderr, "error: ");
+		perror(NULL);
+		return (-1);
 	}
-	free(tokens);
-	return 1;
+	return (1);
 }
 
-int LeftDirect(char *line)
+/**
+ * ifCmdCd - changes directory
+ * @tokens: tokenized array of user-input
+ *
+ * Return: 1 if successful, 3 too many arguments, otherwise error
+ */
+int ifCmdCd(char **tokens)
 {
-	int fd, i = 0, j = 0, position = 0;
-	char *filename;
-	char *args[100];
-	int bufsize = 64;
-	char **tokens = malloc(bufsize * sizeof(char *));
-	char *token;
+	char cwd_buf[PATH_MAX], abs_path[PATH_MAX + 2];
+	char *previous_cwd, *home, *pwd;
+	int chdir_rtn = 0, error_msg = 0;
 
-	if (!tokens)
+	previous_cwd = _getenv("OLDPWD"); /* track previous cwd for '-' handling */
+	home = _getenv("HOME");
+	pwd = _getenv("PWD");
+	if (getcwd(cwd_buf, PATH_MAX) == NULL)
 	{
-		fprintf(stderr, "hsh: allocation error\n");
-		exit(EXIT_FAILURE);
+		perror("getcwd");
+		return (-1);
 	}
 
-	token = strtok(line, " \t\r\n\a");
-	while (token != NULL)
+	if (!pwd) /* set PWD if not already set */
+		_setenv("PWD", cwd_buf, 1);
+
+	if (tokens[1] != NULL && tokens[2] != NULL) /* too many arguments */
+		error_msg = 3;
+	else if (tokens[1] != NULL)
 	{
-		char *marker = _strchr(token, '<');
-		if (marker)
+		if (_strcmp(tokens[1], "~") == 0) /* is home */
 		{
-			*marker = '\0';
-			if (*token != '\0')
+			if (home)
 			{
-				tokens[position++] = token;
+				chdir_rtn = chdir(home);
+				if (chdir_rtn == -1)
+					error_msg = 1;
 			}
-			tokens[position++] = "<";
-			if (*(marker + 1) != '\0')
+			else
+				error_msg = 0;
+		}
+		else if (_strcmp(tokens[1], "-") == 0) /* is previous path */
+			if (previous_cwd)
 			{
-				tokens[position++] = marker + 1;
+				chdir_rtn = chdir(previous_cwd);
+				if (chdir_rtn == -1)
+					printf("%s\n", _getenv("PWD"));
+				else
+					printf("%s\n", previous_cwd);
 			}
-		}
-		else
+			else
+				printf("%s\n", cwd_buf);
+		// else if ((_strncmp(tokens[1], "/root", 5) == 0) && (access(tokens[1], X_OK) != 0))
+		else if (access(tokens[1], X_OK) != 0) /* not permission */
 		{
-			tokens[position++] = token;
+			// printf("\nNOT PERMISSION\n\n");
+			error_msg = 2;
 		}
-
-		if (position >= bufsize)
+		else if (is_directory(tokens[1]) == 0) /* is not a directory */
 		{
-			bufsize += 64;
-			tokens = realloc(tokens, bufsize * sizeof(char *));
-			if (!tokens)
-			{
-				fprintf(stderr, "hsh: allocation error\n");
-				exit(EXIT_FAILURE);
-			}
+			// printf("\nNOT DIRECTORY\n\n");
+			error_msg = 4;
 		}
-		token = strtok(NULL, " \t\r\n\a");
-	}
-	tokens[position] = NULL;
-
-	while (tokens[i] != NULL)
-	{
-		if (_strcmp(tokens[i], "<") == 0)
-			break;
-		args[j++] = tokens[i];
-		i++;
-	}
-	args[j] = NULL;
-
-	if (tokens[i] == NULL || tokens[i + 1] == NULL)
-	{
-		fprintf(stderr, "Syntax error: Missing filename after '<'\n");
-		free(tokens);
-		return -1;
-	}
-
-	filename = tokens[i + 1];
-	fd = open(filename, O_RDONLY);
-	if (fd == -1)
-	{
-		perror("open");
-		free(tokens);
-		return -1;
-	}
-
-	pid_t pid = fork();
-	if (pid == -1)
-	{
-		perror("fork");
-		close(fd);
-		free(tokens);
-		return -1;
-	}
-
-	if (pid == 0)
-	{
-		if (dup2(fd, STDIN_FILENO) == -1)
+		else if (tokens[1][0] == '/') /* is absolute path */
 		{
-			perror("dup2");
-			close(fd);
-			free(tokens);
-			exit(1);
+			chdir_rtn = chdir(tokens[1]);
+			if (chdir_rtn == -1)
+				error_msg = 1;
 		}
-		close(fd);
-
-		if (execvp(args[0], args) == -1)
+		else /* relative path */
 		{
-			fprintf(stderr, "./hsh: %d: %s: not found\n", 1, args[0]);
-			free(tokens);
-			exit(1);
+			_build_path(cwd_buf, tokens[1], abs_path);
+			chdir_rtn = chdir(abs_path);
+			if (chdir_rtn == -1)
+				error_msg = 1;
 		}
-		execvp(args[0], args);
-		perror("execvp");
-		free(tokens);
-		exit(1);
 	}
-	else
+	else /* default go $HOME */
 	{
-		close(fd);
-		wait(NULL);
-	}
-
-	free(tokens);
-	return 1;
-}
-
-int DoubleLeftDirect(char *line)
-{
-	int fd, i = 0, j = 0, position = 0;
-	char *delimiter;
-	char *args[100];
-	int bufsize = 64;
-	char **tokens = malloc(bufsize * sizeof(char *));
-	char *token;
-
-	if (!tokens)
-	{
-		fprintf(stderr, "hsh: allocation error\n");
-		exit(EXIT_FAILURE);
-	}
-
-	token = strtok(line, " \t\r\n\a");
-	while (token != NULL)
-	{
-		char *marker = _strchr(token, '<');
-		if (marker && *(marker + 1) == '<')
+		if (home)
 		{
-			*marker = '\0';
-			if (*token != '\0')
-			{
-				tokens[position++] = token;
-			}
-			tokens[position++] = "<<";
-			if (*(marker + 2) != '\0')
-			{
-				tokens[position++] = marker + 2;
-			}
+			chdir_rtn = chdir(home);
 		}
 		else
-		{
-			tokens[position++] = token;
-		}
-
-		if (position >= bufsize)
-		{
-			bufsize += 64;
-			tokens = realloc(tokens, bufsize * sizeof(char *));
-			if (!tokens)
-			{
-				fprintf(stderr, "hsh: allocation error\n");
-				exit(EXIT_FAILURE);
-			}
-		}
-		token = strtok(NULL, " \t\r\n\a");
-	}
-	tokens[position] = NULL;
-
-	while (tokens[i] != NULL)
-	{
-		if (_strcmp(tokens[i], "<<") == 0)
-			break;
-		args[j++] = tokens[i];
-		i++;
+			error_msg = 0;
 	}
-	args[j] = NULL;
-
-	if (tokens[i] == NULL || tokens[i + 1] == NULL)
+	if ((chdir_rtn == -1) || (error_msg > 0)) /* chdir failed or custom error */
 	{
-		fprintf(stderr, "Syntax error: Missing delimiter after '<<'\n");
-		free(tokens);
-		return -1;
-	}
-
-	delimiter = tokens[i + 1];
+		if ((error_msg == 1) || (error_msg == 4))
+			printf("%s\n", cwd_buf);
 
-	char input[1024];
-	char *input_buffer = input;
-	printf("Enter input (end with %s):\n", delimiter);
-
-	while (fgets(input_buffer, sizeof(input), stdin))
-	{
-		if (strncmp(input_buffer, delimiter, strlen(delimiter)) == 0)
-		{
-			break;
-		}
-		input_buffer += strlen(input_buffer);
-	}
-
-	pid_t pid = fork();
-	if (pid == -1)
-	{
-		perror("fork");
-		free(tokens);
-		return -1;
+		if (chdir_rtn == -1)
+			return (-1);
+		if ((error_msg == 1) || (error_msg == 4))
+			return (1);
+		if (error_msg == 2)
+			return (2);
+		if (error_msg == 3)
+			return (3); /* custom error */
+		return (0);		/* consider return errno */
 	}
-
-	if (pid == 0)
+	else /* on success set OLD PWD and PWD */
 	{
-		fd = open("/tmp/heredoc.txt", O_WRONLY | O_CREAT | O_TRUNC, 0644);
-		if (fd == -1)
-		{
-			perror("open");
-			free(tokens);
-			exit(1);
-		}
-		write(fd, input, strlen(input));
-		close(fd);
-
-		fd = open("/tmp/heredoc.txt", O_RDONLY);
-		if (fd == -1)
-		{
-			perror("open");
-			free(tokens);
-			exit(1);
-		}
+		append_cache_flush(); /* relative ">>" paths name other files now */
+		shell.path_gen++; /* and so may relative PATH entries */
+		_setenv("OLDPWD", cwd_buf, 1);
 
-		if (dup2(fd, STDIN_FILENO) == -1)
+		if (getcwd(cwd_buf, PATH_MAX) == NULL)
 		{
-			perror("dup2");
-			close(fd);
-			free(tokens);
-			exit(1);
-		}
-		close(fd);
-
-		if (execvp(args[0], args) == -1)
-		{
-			fprintf(stderr, "./hsh: %d: %s: not found\n", 1, args[0]);
-			free(tokens);
-			exit(1);
+			perror("getcwd");
+			return (-1);
 		}
-		execvp(args[0], args);
-		perror("execvp");
-		free(tokens);
-		exit(1);
-	}
-	else
-	{
-		wait(NULL);
+		_setenv("PWD", cwd_buf, 1);
 	}
 
-	free(tokens);
-	return 1;
+	return (1); /* success */
 }
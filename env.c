@@ -1,230 +1,1280 @@
 #include "main.h"
 
+#define VAR_OWNED 1	 /* the store frees the entry */
+#define VAR_EXPORT 2 /* the variable is, or becomes, exported */
+#define VAR_KEEP 4	 /* a variable already set is left alone */
+
+#define DECL_INDEXED 1 /* declare -a */
+#define DECL_ASSOC 2   /* declare -A */
+#define DECL_EXPORT 4  /* declare -x */
+#define DECL_PRINT 8   /* declare -p */
+
+/**
+ * struct env_var_s - one shell variable
+ * @entry: "NAME=value"; NULL for a removed variable whose slot has not
+ * been compacted away yet
+ * @name_len: length of NAME
+ * @hash: hash of NAME
+ * @owned: 1 if @entry was malloc'd by the store, 0 if it is the string
+ * inherited in environ (copy-on-write: only a change allocates) or one
+ * a local scope saved
+ * @exported: 1 if children get it in their environment
+ * @arr: the elements of an array variable, NULL for a string one; an
+ * array is never exported and $NAME is its element 0
+ * @cap: bytes allocated for @entry once var_append() gave it room to
+ * grow, 0 otherwise (@entry is then exactly as long as its string)
+ * @len: length of @entry while @cap is set
+ */
+typedef struct env_var_s
+{
+	char *entry;
+	size_t name_len;
+	uint32_t hash;
+	int owned;
+	int exported;
+	array_t *arr;
+	size_t cap;
+	size_t len;
+} env_var_t;
+
+/**
+ * struct var_saved_s - a variable as it was before "local" shadowed it
+ * @entry: its entry, NULL if it was not set
+ * @name: malloc'd name when @entry is NULL
+ * @owned: its owned flag
+ * @exported: its exported flag
+ * @arr: its array
+ */
+typedef struct var_saved_s
+{
+	char *entry;
+	char *name;
+	int owned;
+	int exported;
+	array_t *arr;
+} var_saved_t;
+
+/*
+ * The store: vars is dense and in insertion order (what env prints and
+ * children inherit); slots is an open-addressing index over it, each
+ * slot holding a vars index + 1, 0 when empty. Shell variables and the
+ * environment share it; only exported ones reach envp.
+ */
+static env_var_t *vars;
+static size_t nvars, nlive, nexported, vars_cap;
+static uint32_t *slots;
+static size_t slots_cap;
+static unsigned long env_gen = 1; /* bumped by every change to envp */
+
+/*
+ * Local scopes: saved is a stack of shadowed variables and frames[i]
+ * is where scope i starts in it. Pushing a scope is one store.
+ */
+static var_saved_t *saved;
+static size_t nsaved, saved_cap;
+static size_t *frames;
+static size_t nframes, frames_cap;
+
+/*
+ * The exec-ready environment: one block holding the NULL terminated
+ * pointer array followed by the strings it points to, rebuilt only when
+ * env_gen moved past envp_gen.
+ */
+static char **envp;
+static size_t envp_cap, envp_size;
+static unsigned long envp_gen;
+static char **inherited; /* environ at startup, while it still matches */
+static unsigned long inherited_gen;
+
+/**
+ * name_hash - hashes a variable name (FNV-1a)
+ * @name: name
+ * @len: its length
+ *
+ * Return: hash
+ */
+static uint32_t name_hash(const char *name, size_t len)
+{
+	uint32_t h = 2166136261u;
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		h = (h ^ (unsigned char)name[i]) * 16777619u;
+	return (h);
+}
+
+/**
+ * find_slot - finds a name in the index
+ * @name: name
+ * @len: its length
+ * @hash: its hash
+ *
+ * Return: the slot holding it, or the empty slot where it would go
+ */
+static size_t find_slot(const char *name, size_t len, uint32_t hash)
+{
+	size_t i = hash & (slots_cap - 1);
+	env_var_t *v;
+
+	for (; slots[i] != 0; i = (i + 1) & (slots_cap - 1))
+	{
+		v = &vars[slots[i] - 1];
+		if (v->hash == hash && v->name_len == len &&
+			memcmp(v->entry, name, len) == 0)
+			break;
+	}
+	return (i);
+}
+
 /**
- * _getenv - gets malloc'd environmental value from a name-value pair in environ
- * @name: name in name-value pair
+ * rebuild - compacts the dense array and rebuilds the index
+ * @cap: number of index slots, a power of two above twice the variables
  *
- * Return: dynamically allocated value if found, NULL if not
+ * Return: 0 on success, -1 if out of memory (the store is unchanged)
+ */
+static int rebuild(size_t cap)
+{
+	uint32_t *grown = calloc(cap, sizeof(uint32_t));
+	size_t i, j, k;
+
+	if (grown == NULL)
+		return (-1);
+	for (i = j = 0; i < nvars; i++)
+		if (vars[i].entry != NULL)
+			vars[j++] = vars[i];
+	nvars = j;
+	free(slots);
+	slots = grown;
+	slots_cap = cap;
+	for (i = 0; i < nvars; i++)
+	{
+		k = vars[i].hash & (cap - 1);
+		while (slots[k] != 0)
+			k = (k + 1) & (cap - 1);
+		slots[k] = i + 1;
+	}
+	return (0);
+}
+
+/**
+ * lookup - finds a variable
+ * @name: name, not necessarily NUL terminated
+ * @len: its length
+ *
+ * Return: the variable, NULL if it is not set
+ */
+static env_var_t *lookup(const char *name, size_t len)
+{
+	size_t i;
+
+	if (slots_cap == 0)
+		return (NULL);
+	i = find_slot(name, len, name_hash(name, len));
+	return (slots[i] != 0 ? &vars[slots[i] - 1] : NULL);
+}
+
+/**
+ * _getenv - looks up a variable
+ * @name: name
+ *
+ * Description: one hash and one probe sequence, no allocation.
+ *
+ * Return: the value, pointing into the store: valid until the variable
+ * is next set or unset and not to be modified or freed (element 0 of
+ * an array); NULL if unset
  */
 char *_getenv(const char *name)
 {
-	char **current;
-	char *token;
-	char *temp_line;
-	char *value = NULL;
+	env_var_t *v;
 
-	if (!environ || !name)
+	if (name == NULL)
 		return (NULL);
+	v = lookup(name, _strlen(name));
+	if (v == NULL || v->arr == NULL)
+		return (v != NULL ? v->entry + v->name_len + 1 : NULL);
+	return ((char *)array_get(v->arr, "0", 0));
+}
 
-	for (current = environ; *current; current++)
-	{
-		temp_line = _strdup(*current);
-		if (!temp_line)
-			return (NULL);
+/**
+ * env_put - stores an entry under its name
+ * @entry: "NAME=value"
+ * @len: length of NAME
+ * @flags: VAR_OWNED if the store frees @entry, VAR_EXPORT to export
+ * the variable, VAR_KEEP not to replace an entry already there; a
+ * variable set again keeps its exported flag
+ *
+ * Return: 1 if stored, 0 if the name was set and kept (the caller
+ * keeps @entry), -1 if out of memory
+ */
+static int env_put(char *entry, size_t len, int flags)
+{
+	uint32_t hash = name_hash(entry, len);
+	env_var_t *v, *grown;
+	size_t i;
 
-		token = strtok(temp_line, "=");
-		if (_strcmp(token, name) == 0)
-		{
-			value = strtok(NULL, "=");
-			if (value)
-				value = _strdup(value); /* ensures value isn't dependent on
-									   temp_line ptr */
-			free(temp_line);
-			return (value);
-		}
-		free(temp_line);
+	if ((nlive + 1) * 2 > slots_cap && rebuild(slots_cap ? slots_cap * 2 : 64))
+		return (-1);
+	i = find_slot(entry, len, hash);
+	if (slots[i] != 0 && (flags & VAR_KEEP))
+		return (0);
+	if (slots[i] == 0 && nvars == vars_cap)
+	{
+		grown = realloc(vars, sizeof(env_var_t) * (vars_cap * 2 + 32));
+		if (grown == NULL)
+			return (-1);
+		vars = grown;
+		vars_cap = vars_cap * 2 + 32;
+	}
+	if (slots[i] != 0)
+	{
+		v = &vars[slots[i] - 1];
+		if (v->owned)
+			free(v->entry);
+	}
+	else
+	{
+		v = &vars[nvars];
+		v->name_len = len;
+		v->hash = hash;
+		v->exported = 0;
+		v->arr = NULL;
+		slots[i] = ++nvars;
+		nlive++;
+	}
+	if (!v->exported && (flags & VAR_EXPORT))
+	{
+		v->exported = 1;
+		nexported++;
 	}
-	return (NULL);
+	env_gen += v->exported;
+	if (len == 4 && memcmp(entry, "PATH", 4) == 0)
+		shell.path_gen++; /* command paths resolved so far may be stale */
+	v->entry = entry;
+	v->owned = flags & VAR_OWNED;
+	v->cap = 0;
+	return (1);
 }
 
 /**
- * _setenv - sets an environmental variable to a new value,
- * or appends a new value if not found
- * @name: name of environmental variable to be set
- * @value: value to set the environmental variable to
- * @overwrite: nonzero to change the value, zero to not change
+ * set_var - sets a variable to a copy of a value
+ * @name: name
+ * @value: value
+ * @flags: VAR_EXPORT and VAR_KEEP as for env_put()
  *
- * Return: 0 on success, -1 on failure
+ * Return: 0 on success, -1 on a bad name or out of memory
  */
-int _setenv(const char *name, const char *value, int overwrite)
+static int set_var(const char *name, const char *value, int flags)
 {
-	int i, size_environ = 0;
-	char *temp, *new_line, *temp_line;
-	char **new_environ;
+	size_t len, vlen;
+	char *entry;
+	int put;
+	env_var_t *v;
 
 	if (!name || !value || (_strlen(name) == 0) || _strchr(name, '='))
 		return (-1);
-
-	new_line = malloc(_strlen(name) + _strlen(value) + 2); /* line replacement */
-	if (new_line == NULL)
+	len = _strlen(name);
+	v = lookup(name, len);
+	if (v != NULL && v->arr != NULL) /* NAME=value sets element 0 */
+		return ((flags & VAR_KEEP) ? 0 : array_set(v->arr, "0", 0, value));
+	vlen = _strlen(value);
+	entry = malloc(len + vlen + 2);
+	if (entry == NULL)
 		return (-1);
-	sprintf(new_line, "%s=%s", name, value);
+	memcpy(entry, name, len);
+	entry[len] = '=';
+	memcpy(entry + len + 1, value, vlen + 1);
+	put = env_put(entry, len, flags | VAR_OWNED);
+	if (put != 1)
+		free(entry);
+	return (put == -1 ? -1 : 0);
+}
 
-	if (!environ)
+/**
+ * _setenv - sets a variable and exports it
+ * @name: name
+ * @value: value
+ * @overwrite: nonzero to change the value of a variable already set
+ *
+ * Return: 0 on success, -1 on failure
+ */
+int _setenv(const char *name, const char *value, int overwrite)
+{
+	return (set_var(name, value, VAR_EXPORT | (overwrite ? 0 : VAR_KEEP)));
+}
+
+/**
+ * var_set - sets a shell variable, as NAME=value does
+ * @name: name
+ * @value: value
+ *
+ * Description: a new variable stays out of the environment; one that
+ * was exported stays exported.
+ *
+ * Return: 0 on success, -1 on failure
+ */
+int var_set(const char *name, const char *value)
+{
+	return (set_var(name, value, 0));
+}
+
+/**
+ * var_append - appends to a shell variable, as NAME+=value does
+ * @name: name
+ * @suffix: text to append
+ *
+ * Description: the first append moves the value into a buffer with room
+ * to spare and later ones write into it, doubling it when it is full,
+ * so building a value a piece at a time is linear instead of quadratic.
+ * The value stays one string: nothing needs flattening when it is
+ * expanded or exported. An unset variable is set to @suffix; an array
+ * has it appended to its element 0.
+ *
+ * Return: 0 on success, -1 on a bad name or out of memory
+ */
+int var_append(const char *name, const char *suffix)
+{
+	size_t nlen = _strlen(name), slen = _strlen(suffix), len, cap;
+	env_var_t *v = lookup(name, nlen);
+	const char *old;
+	char *entry;
+
+	if (v == NULL || v->arr != NULL)
 	{
-		char **new_environ = malloc(sizeof(char *) * 2);
-		temp_line = _strdup(new_line);
-		new_environ[0] = temp_line;
-		new_environ[1] = NULL;
-		environ = new_environ;
-		free(new_line);
-		return (0);
+		old = v != NULL ? array_get(v->arr, "0", 0) : NULL;
+		old = old != NULL ? old : "";
+		len = _strlen(old);
+		entry = arena_alloc(len + slen + 1);
+		if (entry == NULL)
+			return (-1);
+		memcpy(entry, old, len);
+		memcpy(entry + len, suffix, slen + 1);
+		return (set_var(name, entry, 0));
+	}
+	len = v->cap ? v->len : (size_t)_strlen(v->entry);
+	if (len + slen + 1 > v->cap)
+	{
+		cap = (len + slen + 1) * 2;
+		entry = v->owned ? realloc(v->entry, cap) : malloc(cap);
+		if (entry == NULL)
+			return (-1);
+		if (!v->owned)
+			memcpy(entry, v->entry, len);
+		v->entry = entry;
+		v->owned = 1;
+		v->cap = cap;
 	}
+	memcpy(v->entry + len, suffix, slen + 1);
+	v->len = len + slen;
+	env_gen += v->exported;
+	if (nlen == 4 && memcmp(name, "PATH", 4) == 0)
+		shell.path_gen++;
+	return (0);
+}
 
-	for (i = 0; environ[i] != NULL && overwrite != 0; i++) /* looks for name */
+/**
+ * var_export - exports a variable
+ * @name: name
+ *
+ * Return: 0 on success, -1 if it is not set
+ */
+int var_export(const char *name)
+{
+	size_t len, i;
+
+	if (name == NULL || slots_cap == 0)
+		return (-1);
+	len = _strlen(name);
+	i = find_slot(name, len, name_hash(name, len));
+	if (slots[i] == 0)
+		return (-1);
+	if (!vars[slots[i] - 1].exported && vars[slots[i] - 1].arr == NULL)
 	{
-		temp_line = _strdup(environ[i]);
-		if (!temp_line)
+		vars[slots[i] - 1].exported = 1;
+		nexported++;
+		env_gen++;
+	}
+	return (0);
+}
+
+/**
+ * env_remove - removes a variable
+ * @name: name, not necessarily NUL terminated
+ * @len: its length
+ *
+ * Description: the index slot is emptied by shifting the rest of its
+ * probe run back; the dense array keeps a hole until holes outnumber
+ * the variables, then it is compacted in one pass.
+ */
+static void env_remove(const char *name, size_t len)
+{
+	size_t i, j, home;
+	env_var_t *v;
+
+	if (slots_cap == 0)
+		return;
+	i = find_slot(name, len, name_hash(name, len));
+	if (slots[i] == 0)
+		return;
+	v = &vars[slots[i] - 1];
+	if (len == 4 && memcmp(name, "PATH", 4) == 0)
+		shell.path_gen++;
+	if (v->owned)
+		free(v->entry);
+	array_free(v->arr);
+	v->entry = NULL;
+	v->arr = NULL;
+	nlive--;
+	nexported -= v->exported;
+	env_gen += v->exported;
+	for (j = (i + 1) & (slots_cap - 1); slots[j] != 0;
+		 j = (j + 1) & (slots_cap - 1))
+	{
+		home = vars[slots[j] - 1].hash & (slots_cap - 1);
+		if ((j > i && (home <= i || home > j)) ||
+			(j < i && home <= i && home > j))
 		{
-			free(new_line);
-			new_line = NULL;
-			return (-1);
+			slots[i] = slots[j];
+			i = j;
 		}
+	}
+	slots[i] = 0;
+	if (nvars - nlive > 16 && nvars - nlive > nlive)
+		rebuild(slots_cap);
+}
 
-		temp = strtok(temp_line, "=");
+/**
+ * _unsetenv - removes a variable, exported or not
+ * @name: name
+ *
+ * Return: 0 (also when the variable was not set)
+ */
+int _unsetenv(const char *name)
+{
+	if ((name != NULL) && (_strlen(name) != 0))
+		env_remove(name, _strlen(name));
+	return (0);
+}
 
-		if (_strcmp(temp, name) == 0) /* name found in environ */
-		{
-			free(environ[i]);
-			environ[i] = _strdup(new_line);
-			free(temp_line);
-			free(new_line);
-			new_line = NULL;
-			temp_line = NULL;
+/**
+ * env_array - the environment as a NULL terminated "NAME=value" array,
+ * for execve() and env
+ *
+ * Description: until the first change, that is the inherited environ
+ * itself. After that, the pointers and strings are copied into one
+ * block, only when the environment changed since the last call, so every
+ * spawn in between passes the same few contiguous pages. environ is
+ * pointed at it too.
+ *
+ * Return: the array, owned by the store
+ */
+char **env_array(void)
+{
+	size_t i, j, need = sizeof(char *) * (nexported + 1), len;
+	char **block, *str;
+
+	if (inherited != NULL && inherited_gen == env_gen)
+		return (inherited); /* nothing changed since startup */
+	if (envp_gen == env_gen && envp != NULL)
+		return (envp);
+	for (i = 0; i < nvars; i++)
+		if (vars[i].entry != NULL && vars[i].exported)
+			need += _strlen(vars[i].entry) + 1;
+	block = envp;
+	if (need > envp_cap)
+	{
+		block = malloc(need + need / 2);
+		if (block == NULL)
+			return (envp != NULL ? envp : environ);
+		free(envp);
+		envp_cap = need + need / 2;
+	}
+	str = (char *)(block + nexported + 1);
+	for (i = j = 0; i < nvars; i++)
+	{
+		if (vars[i].entry == NULL || !vars[i].exported)
+			continue;
+		len = _strlen(vars[i].entry) + 1;
+		memcpy(str, vars[i].entry, len);
+		block[j++] = str;
+		str += len;
+	}
+	block[j] = NULL;
+	envp = block;
+	envp_size = need;
+	envp_gen = env_gen;
+	environ = envp;
+	return (envp);
+}
+
+/**
+ * env_size - bytes the environment takes in execve()'s ARG_MAX
+ *
+ * Return: its strings and pointers, terminator included
+ */
+size_t env_size(void)
+{
+	env_array();
+	return (envp_size);
+}
+
+/**
+ * entry_named - tells whether a "NAME=value" entry has a given name
+ * @entry: entry
+ * @name: name, ending at its first '=' or NUL
+ *
+ * Return: 1 if the names are the same, 0 otherwise
+ */
+static int entry_named(const char *entry, const char *name)
+{
+	for (; *name != '\0' && *name != '='; entry++, name++)
+		if (*entry != *name)
 			return (0);
-		}
-		free(temp_line);
-		temp_line = NULL;
+	return (*entry == '=');
+}
+
+/**
+ * env_overlay - the environment one command runs with, leaving the
+ * shell's own untouched
+ * @clear: 1 to start from an empty environment (env -i)
+ * @set: "NAME=value" entries to add or replace; later ones win
+ * @nset: number of @set entries
+ * @unset: names to leave out (env -u)
+ * @nunset: number of @unset names
+ *
+ * Description: one arena allocation of pointers, into the cached
+ * environment and into @set. The cached entries are only compared
+ * with the names when one of those names is actually set.
+ *
+ * Return: NULL terminated array, or the unmodified environment if the
+ * arena is out of memory
+ */
+char **env_overlay(int clear, char **set, int nset, char **unset, int nunset)
+{
+	char **base = clear ? NULL : env_array(), **envp, *name;
+	int i, j, n = 0, scan = 0;
+
+	envp = arena_alloc(sizeof(char *) * ((clear ? 0 : nexported) + nset + 1));
+	if (envp == NULL)
+		return (env_array());
+	for (i = 0; !clear && !scan && i < nset + nunset; i++)
+	{
+		name = i < nset ? set[i] : unset[i - nset];
+		scan = _getenv(arena_strdup(name, _strcspn(name, "="))) != NULL;
+	}
+	for (; base != NULL && *base != NULL; base++)
+	{
+		for (i = 0; scan && i < nset + nunset; i++)
+			if (entry_named(*base, i < nset ? set[i] : unset[i - nset]))
+				break;
+		if (!scan || i == nset + nunset)
+			envp[n++] = *base;
+	}
+	for (i = 0; i < nset; i++)
+	{
+		for (j = i + 1; j < nset; j++)
+			if (entry_named(set[j], set[i]))
+				break;
+		if (j == nset)
+			envp[n++] = set[i];
 	}
+	envp[n] = NULL;
+	return (envp);
+}
 
-	size_environ = i;
-	if (overwrite != 0 && environ[i] == NULL) /* if adding at end */
+/**
+ * cmd_envp - the environment to execve() a command with
+ * @cmd: built command
+ *
+ * Return: the cached environment, with the command's own VAR=value
+ * prefixes laid over it if it has any
+ */
+char **cmd_envp(const command_t *cmd)
+{
+	if (cmd->nassigns == 0)
+		return (env_array());
+	return (env_overlay(0, cmd->assigns, cmd->nassigns, NULL, 0));
+}
+
+/**
+ * var_array - the array of an array variable
+ * @name: name
+ * @create: 0 to only look it up, 1 to make the variable an indexed
+ * array if it is not an array yet (a string becomes element 0), 2 to
+ * make it an associative one
+ *
+ * Return: the array, owned by the store; NULL if it is not an array
+ * (and @create is 0) or out of memory
+ */
+array_t *var_array(const char *name, int create)
+{
+	env_var_t *v = lookup(name, _strlen(name));
+	array_t *a;
+
+	if (v != NULL && v->arr != NULL)
+		return (v->arr);
+	if (!create)
+		return (NULL);
+	a = array_new(create == 2);
+	if (a == NULL)
+		return (NULL);
+	if (v == NULL && set_var(name, "", 0) == 0)
+		v = lookup(name, _strlen(name));
+	if (v == NULL || (create == 1 &&
+					  array_set(a, NULL, 0, v->entry + v->name_len + 1) == -1))
 	{
-		new_environ = _realloc_array(environ, sizeof(char *) * (size_environ + 2));
-		if (new_environ == NULL)
-		{
-			free(new_line);
-			new_line = NULL;
-			return (-1);
-		}
+		array_free(a);
+		return (NULL);
+	}
+	if (v->exported)
+	{
+		v->exported = 0;
+		nexported--;
+		env_gen++;
+	}
+	v->arr = a;
+	return (a);
+}
+
+/**
+ * array_subscript - works out the index an indexed array subscript
+ * stands for
+ * @a: indexed array, NULL for a scalar (an array of one element)
+ * @sub: expanded subscript: a number, negative to count from the end,
+ * or the name of a variable holding one (an unset one is 0)
+ * @index: receives the index
+ *
+ * Description: there is no arithmetic, so anything else ("i+1") is
+ * not a valid index.
+ *
+ * Return: 0 on success, -1 if it is not a valid index
+ */
+int array_subscript(const array_t *a, const char *sub, size_t *index)
+{
+	size_t n = 0, length = a != NULL ? array_length(a) : 1;
+	const char *p = sub;
 
-		new_environ[size_environ] = new_line; /* sets new env variable */
-		new_environ[size_environ + 1] = NULL; /* makes final as NULL */
-		environ = new_environ;
+	if (isalpha((unsigned char)*sub) || *sub == '_')
+	{
+		while (isalnum((unsigned char)*p) || *p == '_')
+			p++;
+		if (*p != '\0')
+			return (-1);
+		p = _getenv(sub) != NULL ? _getenv(sub) : "0";
 	}
+	sub = p;
+	p += *p == '-';
+	if (*p == '\0')
+		return (-1);
+	for (; isdigit((unsigned char)*p); p++)
+		n = n * 10 + (*p - '0');
+	if (*p != '\0' || (*sub == '-' && n > length))
+		return (-1);
+	*index = *sub == '-' ? length - n : n;
+	return (0);
+}
 
+/**
+ * var_entries - every variable, exported or not
+ *
+ * Return: NULL terminated arena array of "NAME=value" entries, in the
+ * order they were first set; NULL if out of memory
+ */
+char **var_entries(void)
+{
+	char **list = arena_alloc(sizeof(char *) * (nlive + 1));
+	size_t i, n = 0;
+
+	for (i = 0; list != NULL && i < nvars; i++)
+		if (vars[i].entry != NULL)
+			list[n++] = vars[i].entry;
+	if (list != NULL)
+		list[n] = NULL;
+	return (list);
+}
+
+/**
+ * var_push_scope - starts a scope, for the NAME=value prefix of a builtin
+ *
+ * Return: 0 on success, -1 if out of memory
+ */
+int var_push_scope(void)
+{
+	size_t *grown;
+
+	if (nframes == frames_cap)
+	{
+		grown = realloc(frames, sizeof(size_t) * (frames_cap * 2 + 8));
+		if (grown == NULL)
+			return (-1);
+		frames = grown;
+		frames_cap = frames_cap * 2 + 8;
+	}
+	frames[nframes++] = nsaved;
 	return (0);
 }
 
 /**
- * _unsetenv - unsets an environmental variable
- * @name: name of environmental variable to remove
+ * var_local - shadows a variable until the current scope ends
+ * @name: name
+ * @value: new value, NULL to keep the current one
+ * @flags: VAR_EXPORT to export it within the scope, 0 otherwise
+ *
+ * Description: the current entry itself is saved, not a copy of it;
+ * the variable only stops owning it so that setting it does not free
+ * what var_pop_scope() puts back.
  *
- * Return: 0 if success, -1 on failure
+ * Return: 0 on success, -1 outside a scope, on a bad name or out of
+ * memory
  */
-int _unsetenv(const char *name)
+static int var_local(const char *name, const char *value, int flags)
 {
-	/* check name, check environ, if found new_environ without name */
-	int size_environ = 0;
-	char **new_environ;
-	int location = -1, i, new_environ_index = 0;
+	var_saved_t *grown, *sv;
+	size_t len = name ? _strlen(name) : 0, i;
+	env_var_t *v;
 
-	if ((name == NULL) || (_strlen(name) == 0) || !environ)
-		return (0);
+	if (nframes == 0 || len == 0 || _strchr(name, '='))
+		return (-1);
+	if (nsaved == saved_cap)
+	{
+		grown = realloc(saved, sizeof(var_saved_t) * (saved_cap * 2 + 16));
+		if (grown == NULL)
+			return (-1);
+		saved = grown;
+		saved_cap = saved_cap * 2 + 16;
+	}
+	sv = &saved[nsaved];
+	i = slots_cap ? find_slot(name, len, name_hash(name, len)) : 0;
+	if (slots_cap != 0 && slots[i] != 0)
+	{
+		v = &vars[slots[i] - 1];
+		sv->entry = v->entry;
+		sv->name = NULL;
+		sv->owned = v->owned;
+		sv->exported = v->exported;
+		sv->arr = v->arr;
+		v->owned = 0;
+		v->cap = 0;
+		v->arr = NULL;
+	}
+	else
+	{
+		sv->entry = NULL;
+		sv->arr = NULL;
+		sv->name = _strdup(name);
+		if (sv->name == NULL)
+			return (-1);
+	}
+	nsaved++;
+	return (value == NULL ? 0 : set_var(name, value, flags));
+}
+
+/**
+ * var_pop_scope - ends the current scope, putting back every variable
+ * it shadowed
+ */
+void var_pop_scope(void)
+{
+	var_saved_t *sv;
+	const char *name;
 
-	/* find size of array and location of possible match */
-	for (i = 0; environ[i] != NULL; i++)
+	if (nframes == 0)
+		return;
+	for (nframes--; nsaved > frames[nframes];)
 	{
-		size_environ++;
-		if ((_strncmp(environ[i], name, _strlen(name)) == 0) &&
-			(environ[i][_strlen(name)] == '='))
-			location = i;
+		sv = &saved[--nsaved];
+		name = sv->entry != NULL ? sv->entry : sv->name;
+		env_remove(name, _strcspn(name, "="));
+		if (sv->entry != NULL &&
+			env_put(sv->entry, _strcspn(name, "="),
+					(sv->owned ? VAR_OWNED : 0) | (sv->exported ? VAR_EXPORT : 0)) == 1)
+			lookup(name, _strcspn(name, "="))->arr = sv->arr;
+		else
+			array_free(sv->arr);
+		free(sv->name);
 	}
-	/* if match found rebuild environ without the found element */
-	if ((location < i) && (location != -1))
+}
+
+/**
+ * set_element - sets one element of an array from a subscript
+ * @a: array
+ * @name: its name, for messages
+ * @sub: expanded subscript
+ * @value: value
+ *
+ * Return: 0 on success, -1 on a bad subscript (message printed) or out
+ * of memory
+ */
+static int set_element(array_t *a, const char *name, const char *sub,
+					   const char *value)
+{
+	size_t index = 0;
+
+	if (!array_is_assoc(a) && array_subscript(a, sub, &index) == -1)
 	{
-		new_environ = malloc(sizeof(char *) * size_environ);
-		for (i = 0; i < size_environ; i++)
+		fprintf(stderr, "%s: 1: %s[%s]: bad array subscript\n", shell.name,
+				name, sub);
+		return (-1);
+	}
+	return (array_set(a, sub, index, value));
+}
+
+/**
+ * assign_array - carries out a NAME[subscript]=value or NAME=(...)
+ * @as: built assignment
+ *
+ * Description: NAME=(...) replaces every element. In an indexed array,
+ * elements without [index]= follow the one before; an associative
+ * array needs a [key]= on each.
+ *
+ * Return: 0 on success, -1 on error (message printed)
+ */
+int assign_array(const array_assign_t *as)
+{
+	array_t *a = var_array(as->name, 1);
+	size_t next = 0;
+	int i;
+
+	if (a == NULL)
+		return (-1);
+	if (as->subscript != NULL)
+		return (set_element(a, as->name, as->subscript, as->value));
+	array_clear(a);
+	for (i = 0; i < as->nelems; i++)
+	{
+		if (as->keys[i] == NULL && array_is_assoc(a))
 		{
-			if (i != location) /* copy all except target variable */
-			{
-				new_environ[new_environ_index] = _strdup(environ[i]);
-				new_environ_index++;
-			}
-			free(environ[i]);
+			fprintf(stderr, "%s: 1: %s: %s: must use subscript when "
+					"assigning associative array\n", shell.name, as->name,
+					as->elems[i]);
+			return (-1);
 		}
-		new_environ[new_environ_index] = NULL;
-
-		free(environ);
-		environ = new_environ;
+		if (as->keys[i] != NULL &&
+			set_element(a, as->name, as->keys[i], as->elems[i]) == -1)
+			return (-1);
+		if (as->keys[i] != NULL && !array_is_assoc(a))
+			array_subscript(a, as->keys[i], &next);
+		if (as->keys[i] == NULL && array_set(a, NULL, next, as->elems[i]))
+			return (-1);
+		next++;
 	}
 	return (0);
 }
 
 /**
- * ifCmdUnsetEnv - unsets an env variable if found
- * @tokens: tokenized list of commands
+ * assign_word - sets a shell variable from a NAME=value word, or
+ * appends to it from NAME+=value
+ * @word: expanded assignment
  *
- * Return: 1 if successful, otherwise 0
+ * Return: 0 on success, -1 on error
  */
-int ifCmdUnsetEnv(char **tokens)
+int assign_word(const char *word)
 {
-	if (tokens[0] && (_strcmp(tokens[0], "unsetenv") == 0))
+	size_t len = _strcspn(word, "=");
+	char *name = arena_strdup(word, len);
+
+	if (name == NULL)
+		return (-1);
+	if (len > 0 && name[len - 1] == '+')
 	{
-		if (!tokens[1])
-			return (1);
-		if (_unsetenv(tokens[1]) == 0)
-			return (1);
+		name[len - 1] = '\0';
+		return (var_append(name, word + len + 1));
 	}
-	return (0);
+	return (var_set(name, word + len + 1));
 }
 
 /**
- * initialize_environ - makes environ a dynamically allocated variable
+ * env_assign - sets a command's VAR=value prefixes
+ * @cmd: built command
+ * @local: 1 to set them, exported, in the current scope (a builtin's
+ * prefixes), 0 to set them as shell variables (a line of assignments
+ * alone)
+ *
+ * Description: array assignments, which are never exported, only take
+ * effect on a line of their own, and so do the "NAME+=value" appends
+ * build_command() leaves in place.
+ *
+ * Return: 0 on success, -1 if an array assignment failed
  */
+int env_assign(const command_t *cmd, int local)
+{
+	size_t len;
+	char *name;
+	int i, rtn = 0;
+
+	for (i = 0; i < cmd->nassigns; i++)
+	{
+		len = _strcspn(cmd->assigns[i], "=");
+		name = local ? arena_strdup(cmd->assigns[i], len) : NULL;
+		if (name != NULL)
+			var_local(name, cmd->assigns[i] + len + 1, VAR_EXPORT);
+		else if (!local)
+			assign_word(cmd->assigns[i]);
+	}
+	for (i = 0; !local && i < cmd->narrays; i++)
+		if (assign_array(&cmd->arrays[i]) == -1)
+			rtn = -1;
+	return (rtn);
+}
+
 /**
- * initialize_environ - makes environ a dynamically allocated variable
+ * env_free - frees the whole store
  */
-void initialize_environ(void)
+void env_free(void)
+{
+	size_t i;
+
+	while (nframes > 0)
+		var_pop_scope();
+	for (i = 0; i < nvars; i++)
+	{
+		if (vars[i].owned)
+			free(vars[i].entry);
+		array_free(vars[i].arr);
+	}
+	free(vars);
+	free(saved);
+	free(frames);
+	free(slots);
+	free(envp);
+	vars = NULL;
+	slots = NULL;
+	envp = NULL;
+	inherited = NULL;
+	saved = NULL;
+	frames = NULL;
+	nvars = nlive = nexported = vars_cap = slots_cap = 0;
+	envp_cap = envp_size = nsaved = saved_cap = nframes = frames_cap = 0;
+	env_gen++;
+	environ = NULL;
+}
+
+/**
+ * put_quoted - prints a value in single quotes
+ * @s: value
+ */
+static void put_quoted(const char *s)
+{
+	putchar('\'');
+	for (; *s != '\0'; s++)
+		if (*s == '\'')
+			fputs("'\\''", stdout);
+		else
+			putchar(*s);
+	putchar('\'');
+}
+
+/**
+ * print_var - prints a variable so that the shell can read it back
+ * @prefix: "" or "export "
+ * @entry: "NAME=value"
+ *
+ * Description: an array is printed as NAME=([key]='value' ...).
+ */
+void print_var(const char *prefix, const char *entry)
 {
-	int i = 0, size_environ = 0;
-	char **new_environ;
-	path_t *path_list; // to free path
+	const char *eq = _strchr(entry, '=');
+	env_var_t *v = lookup(entry, eq - entry);
+	char **keys, **vals;
+	int i;
 
-	/* First, get the size of the ORIGINAL environ */
-	while (environ[i] != NULL)
+	printf("%s%.*s=", prefix, (int)(eq - entry), entry);
+	if (v == NULL || v->arr == NULL)
+		put_quoted(eq + 1);
+	else
 	{
+		keys = array_list(v->arr, 1);
+		vals = array_list(v->arr, 0);
+		putchar('(');
+		for (i = 0; keys != NULL && vals != NULL && keys[i] != NULL; i++)
+		{
+			printf(i > 0 ? " [%s]=" : "[%s]=", keys[i]);
+			put_quoted(vals[i]);
+		}
+		putchar(')');
+	}
+	putchar('\n');
+}
+
+/**
+ * cmp_entries - qsort() order of "NAME=value" entries by name
+ * @a: first entry
+ * @b: second entry
+ *
+ * Return: <0, 0 or >0
+ */
+static int cmp_entries(const void *a, const void *b)
+{
+	const char *x = *(char *const *)a, *y = *(char *const *)b;
+
+	for (; *x == *y && *x != '=' && *x != '\0'; x++, y++)
+		;
+	return ((*x == '=' ? 0 : (unsigned char)*x + 1) -
+			(*y == '=' ? 0 : (unsigned char)*y + 1));
+}
+
+/**
+ * print_vars - prints variables sorted by name, as set and export do
+ * @list: NULL terminated entries; sorted in place
+ * @prefix: "" or "export "
+ */
+void print_vars(char **list, const char *prefix)
+{
+	size_t n;
+
+	for (n = 0; list != NULL && list[n] != NULL; n++)
+		;
+	if (n > 1)
+		qsort(list, n, sizeof(char *), cmp_entries);
+	for (; n > 0; n--, list++)
+		print_var(prefix, *list);
+}
+
+/**
+ * ifCmdExport - export [-p] [NAME[=value]]...
+ * @tokens: tokenized user-input
+ *
+ * Description: with no names (or -p), lists the exported variables.
+ * "export NAME" of a variable that is not set does nothing.
+ *
+ * Return: 1
+ */
+int ifCmdExport(char **tokens)
+{
+	char **list, *eq, *name;
+	int i = 1, n;
+
+	if (tokens[1] != NULL && _strcmp(tokens[1], "-p") == 0)
 		i++;
+	if (tokens[i] == NULL)
+	{
+		for (n = 0; env_array()[n] != NULL; n++)
+			;
+		list = arena_alloc(sizeof(char *) * (n + 1));
+		if (list != NULL)
+			memcpy(list, env_array(), sizeof(char *) * (n + 1));
+		print_vars(list, "export ");
+		return (1);
+	}
+	for (; tokens[i] != NULL; i++)
+	{
+		eq = _strchr(tokens[i], '=');
+		name = eq ? arena_strdup(tokens[i], eq - tokens[i]) : tokens[i];
+		if (name == NULL || (eq ? _setenv(name, eq + 1, 1) == -1 :
+							 (*name == '\0' || _strchr(name, '='))))
+		{
+			fprintf(stderr, "%s: 1: export: %s: bad variable name\n",
+					shell.name, tokens[i]);
+			shell.status = 2;
+		}
+		else if (!eq)
+			var_export(name);
 	}
-	size_environ = i;
+	return (1);
+}
+
+/**
+ * unset_name - unsets a variable, or an element with NAME[subscript]
+ * @word: NAME or NAME[subscript]
+ */
+static void unset_name(char *word)
+{
+	char *open = _strchr(word, '['), *name;
+	size_t len = _strlen(word), index;
+	array_t *a;
 
-	/* Allocate memory for the NEW environment array */
-	new_environ = malloc(sizeof(char *) * (size_environ + 1));
-	if (new_environ == NULL)
+	if (open == NULL || open == word || word[len - 1] != ']')
 	{
-		perror("malloc failed");
+		_unsetenv(word);
 		return;
 	}
+	name = arena_strdup(word, open - word);
+	a = name != NULL ? var_array(name, 0) : NULL;
+	word[len - 1] = '\0';
+	if (a != NULL && array_is_assoc(a))
+		array_unset(a, open + 1, 0);
+	else if (a != NULL && array_subscript(a, open + 1, &index) == 0)
+		array_unset(a, NULL, index);
+	word[len - 1] = ']';
+}
 
-	/* Copy the strings from the ORIGINAL environ to the NEW environ */
-	for (i = 0; i < size_environ; i++)
+/**
+ * declare_options - reads the options of a declare command
+ * @tokens: its words
+ * @i: index of the first option; set to that of the first name
+ *
+ * Return: DECL_* bits, -1 on an unknown option (usage printed)
+ */
+static int declare_options(char **tokens, int *i)
+{
+	int flags = 0;
+	char *o;
+
+	for (; tokens[*i] != NULL && tokens[*i][0] == '-'; (*i)++)
 	{
-		new_environ[i] = _strdup(environ[i]);
-		if (new_environ[i] == NULL)
+		if (_strcmp(tokens[*i], "--") == 0)
 		{
-			/* Handle _strdup failure: free previously allocated strings */
-			for (int j = 0; j < i; j++)
-			{
-				free(new_environ[j]);
-			}
-			free(new_environ);
-			fprintf(stderr, "malloc fail in initialize_environ\n");
-			return;
+			(*i)++;
+			break;
 		}
+		for (o = tokens[*i] + 1; *o == 'a' || *o == 'A' || *o == 'x' ||
+			 *o == 'p'; o++)
+			flags |= *o == 'a' ? DECL_INDEXED : *o == 'A' ? DECL_ASSOC :
+					 *o == 'x' ? DECL_EXPORT : DECL_PRINT;
+		if (*o != '\0' || o == tokens[*i] + 1)
+		{
+			fprintf(stderr, "%s: 1: declare: usage: declare [-aAxp] "
+					"[NAME[=value]]...\n", shell.name);
+			shell.status = 2;
+			return (-1);
+		}
+	}
+	return (flags);
+}
+
+/**
+ * print_declared - prints a variable as the declare command that sets it
+ * @name: name
+ *
+ * Return: 0, -1 if it is not set (message printed)
+ */
+static int print_declared(const char *name)
+{
+	env_var_t *v = lookup(name, _strlen(name));
+
+	if (v == NULL || v->entry == NULL)
+	{
+		fprintf(stderr, "%s: 1: declare: %s: not found\n", shell.name, name);
+		return (-1);
+	}
+	print_var(v->arr == NULL ? (v->exported ? "declare -x " : "declare -- ") :
+			  array_is_assoc(v->arr) ? "declare -A " : "declare -a ",
+			  v->entry);
+	return (0);
+}
+
+/**
+ * declare_one - declares one NAME[=value]
+ * @word: the word
+ * @flags: DECL_* bits
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int declare_one(char *word, int flags)
+{
+	int kind = flags & DECL_ASSOC ? 2 : flags & DECL_INDEXED ? 1 : 0;
+	char *eq = _strchr(word, '='), *name;
+	array_t *a;
+	array_assign_t as;
+
+	name = eq ? arena_strdup(word, eq - word) : word;
+	a = name != NULL && kind ? var_array(name, kind) : NULL;
+	if (name == NULL || *name == '\0' || (kind && a == NULL) ||
+		(kind == 2 && !array_is_assoc(a)))
+	{
+		fprintf(stderr, "%s: 1: declare: %s: cannot declare\n",
+				shell.name, word);
+		return (-1);
+	}
+	if (eq && eq[1] == '(' && eq[_strlen(eq) - 1] == ')')
+	{
+		if (build_compound(word, &as) == -1 || assign_array(&as) == -1)
+			return (-1);
+	}
+	else if (eq && a != NULL)
+		array_set(a, "0", 0, eq + 1);
+	else if (eq && var_set(name, eq + 1) == -1)
+		return (-1);
+	if (flags & DECL_EXPORT)
+		var_export(name);
+	return (0);
+}
+
+/**
+ * ifCmdDeclare - declare [-aAxp] [NAME[=value]]...
+ * @tokens: tokenized user-input
+ *
+ * Description: -a makes each NAME an indexed array and -A an
+ * associative one; a value sets element 0 (or key "0"), and
+ * NAME=(...) sets the whole array as it does on a line of its own. -x
+ * exports each NAME that is set. -p prints each NAME as the declare
+ * command that sets it instead. With no names, lists every variable
+ * like set. Any other option is a usage error.
+ *
+ * Return: 1
+ */
+int ifCmdDeclare(char **tokens)
+{
+	int i = 1, flags;
+
+	flags = declare_options(tokens, &i);
+	if (flags == -1)
+		return (1);
+	if (tokens[i] == NULL)
+		print_vars(var_entries(), "");
+	for (; tokens[i] != NULL; i++)
+		if (flags & DECL_PRINT ? print_declared(tokens[i]) == -1 :
+			declare_one(tokens[i], flags) == -1)
+			shell.status = 1;
+	return (1);
+}
+
+/**
+ * ifCmdUnset - unset [-v] NAME...: removes variables
+ * @tokens: tokenized user-input
+ *
+ * Return: 1
+ */
+int ifCmdUnset(char **tokens)
+{
+	int i = 1;
+
+	if (tokens[1] != NULL && _strcmp(tokens[1], "-v") == 0)
+		i++;
+	for (; tokens[i] != NULL; i++)
+		unset_name(tokens[i]);
+	return (1);
+}
+
+/**
+ * ifCmdUnsetEnv - unsets an env variable if found
+ * @tokens: tokenized list of commands
+ *
+ * Return: 1
+ */
+int ifCmdUnsetEnv(char **tokens)
+{
+	if (tokens[1] != NULL)
+		_unsetenv(tokens[1]);
+	return (1);
+}
+
+/**
+ * initialize_environ - loads the inherited environment into the store
+ *
+ * Description: the entries point at the inherited strings, which are
+ * only copied when a variable is changed. The first of several
+ * definitions of a name wins, as with getenv(). The inherited size is
+ * measured here, since env_size() reports it until the first change.
+ */
+void initialize_environ(void)
+{
+	char **e, *eq;
+	int exact = 1, put;
+	size_t size = sizeof(char *);
+
+	for (e = environ; e != NULL && *e != NULL; e++)
+	{
+		eq = _strchr(*e, '=');
+		put = (eq == NULL || eq == *e) ? 0 : env_put(*e, eq - *e, VAR_EXPORT | VAR_KEEP);
+		if (put == -1)
+			fprintf(stderr, "malloc fail in initialize_environ\n");
+		exact = exact && put == 1;
+		size += _strlen(*e) + 1 + sizeof(char *);
+	}
+	if (exact) /* execve() can be handed environ as it is */
+	{
+		inherited = environ;
+		inherited_gen = env_gen;
+		envp_size = size;
 	}
-	new_environ[size_environ] = NULL; /* Null-terminate the new array */
-	/* Now it's safe to reassign 'environ' */
-	environ = new_environ;
-	path_list = buildListPath(); /* build the list path, save to var */
-	destroyListPath(path_list);
 }
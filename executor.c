@@ -1,158 +1,375 @@
 #include "main.h"
 #define FORK_ERROR -1
 #define WAITPID_ERROR -2
+#define MAX_BACKGROUND 64
 
 /**
- * execute_pipe_command - Executes two commands, connecting their
- *                        standard input and output with a pipe.
- * @command1: The first command (left side of pipe).  This is an array
- *             of strings, where command1[0] is the command name,
- *             and subsequent elements are the arguments.  This array
- *             MUST be NULL-terminated.
- * @command2: The second command (right side of pipe).  Same format as
- *             command1.
+ * run_pipeline_child - runs one pipeline stage in its forked child
+ * @cmd: parsed stage; its redirections override the pipe ends
  *
- * Return: 0 on success, the exit status of the *second* command if
- *         either command fails, or -1 on system call errors (pipe, fork).
- *         Returns 127 if either command is not found.
+ * Description: builtins run right here and exit with their status, so
+ * "echo hi | cat" and "cat f | read x" work like any other stage.
  */
-void execute_pipe_command(char **commands, int num_commands)
+static void run_pipeline_child(command_t *cmd)
 {
-	if (num_commands <= 0)
-	{
-		return; /* Nothing to do */
-	}
+	char *full_path;
 
-	if (num_commands == 1)
+	if (apply_redirections(cmd->redirs, cmd->nredirs, NULL) == -1)
+		_exit(EXIT_FAILURE);
+	if (cmd->argv[0] == NULL)
+		_exit(EXIT_SUCCESS);
+	if (cmd->builtin)
 	{
-		/* If there's only one command, we don't need pipes where we're going. */
-		char **args = parse_command(commands[0]);
-		if (args != NULL)
-		{
-			if (args[0] != NULL)
-			{ /* check for empty command */
-				char *full_path = findPath(args[0]);
-				if (full_path != NULL)
-				{
-					execute_command(full_path, args);
-					free(full_path);
-				}
-				else
-				{ /* command not found */
-					fprintf(stderr, "%s: command not found\n", args[0]);
-				}
-			}
-			free(args);
-		}
-		return;
+		if (var_push_scope() == 0) /* this child is the builtin's shell */
+			env_assign(cmd, 1);
+		shell.status = 0;
+		customCmd(cmd->argv, 0, NULL);
+		fflush(stdout);
+		_exit(shell.status);
 	}
-
-	/* --- Multiple commands, create pipes --- */
-
-	int pipes[num_commands - 1][2]; /* Array of pipes */
-	pid_t pids[num_commands];		/* Array to store child PIDs */
-
-	/* Create all necessary pipes */
-	for (int i = 0; i < num_commands - 1; i++)
+	full_path = cmd->path;
+	if (full_path == NULL)
 	{
-		if (pipe(pipes[i]) < 0)
-		{
-			perror("pipe");
-			return; /* Handle pipe creation failure */
-		}
+		fprintf(stderr, "%s: 1: %s: not found\n", shell.name, cmd->argv[0]);
+		_exit(127);
 	}
+	if (batch_needed(cmd))
+		_exit(run_batched(full_path, cmd));
+	execve(full_path, cmd->argv, cmd_envp(cmd));
+	perror("execve"); /* If execve returns, it failed */
+	_exit(126);
+}
+
+/**
+ * run_stages - forks every pipeline stage and waits for all of them
+ * @stages: stage nodes; a subshell stage runs its list in the child
+ * @cmds: expanded N_COMMAND stages
+ * @pipes: num_commands - 1 open pipes, closed before returning
+ * @num_commands: number of stages
+ */
+static void run_stages(node_t **stages, command_t *cmds, int (*pipes)[2],
+					   int num_commands)
+{
+	int i, j, status, started = 0;
+	pid_t pids[num_commands];
 
-	/* Fork and execute each command */
-	for (int i = 0; i < num_commands; i++)
+	for (i = 0; i < num_commands; i++)
+		append_cache_prepare(cmds[i].redirs, cmds[i].nredirs);
+	fflush(NULL);
+	for (i = 0; i < num_commands; i++, started++)
 	{
 		pids[i] = fork();
 		if (pids[i] < 0)
 		{
 			perror("fork");
-			return; /* Handle fork failure */
+			break;
 		}
-		else if (pids[i] == 0)
+		if (pids[i] == 0)
 		{
-			/* Child process */
-
-			/* Redirect input (except for the first command) */
-			if (i > 0)
-			{
-				if (dup2(pipes[i - 1][0], STDIN_FILENO) < 0)
-				{
-					perror("dup2 (stdin)");
-					exit(EXIT_FAILURE);
-				}
-			}
-
-			/* Redirect output (except for the last command) */
-			if (i < num_commands - 1)
+			if ((i > 0 && dup2(pipes[i - 1][0], STDIN_FILENO) < 0) ||
+				(i < num_commands - 1 && dup2(pipes[i][1], STDOUT_FILENO) < 0))
 			{
-				if (dup2(pipes[i][1], STDOUT_FILENO) < 0)
-				{
-					perror("dup2 (stdout)");
-					exit(EXIT_FAILURE);
-				}
+				perror("dup2");
+				_exit(EXIT_FAILURE);
 			}
-
-			/* Close all pipe ends in the child */
-			for (int j = 0; j < num_commands - 1; j++)
+			for (j = 0; j < num_commands - 1; j++)
 			{
 				close(pipes[j][0]);
 				close(pipes[j][1]);
 			}
-
-			/* Parse the command */
-			char **args = parse_command(commands[i]);
-			if (args == NULL || args[0] == NULL)
-			{
-				fprintf(stderr, "Invalid command\n"); /* error message */
-				exit(EXIT_FAILURE);
-			}
-			char *full_path = findPath(args[0]); /* find full path */
-			if (full_path == NULL)
+			coproc_close_fds();
+			if (stages[i]->type != N_COMMAND)
 			{
-				fprintf(stderr, "%s: command not found\n", args[0]);
-				exit(127); 
+				run_node(stages[i], 0);
+				childExit(shell.status);
 			}
-			/* Execute the command */
-			execve(full_path, args, environ);
-			perror("execve"); /* If execve returns, it failed */
-			exit(EXIT_FAILURE);
+			run_pipeline_child(&cmds[i]);
 		}
 	}
 
 	/* Parent process: Close all pipe ends */
-	for (int i = 0; i < num_commands - 1; i++)
+	for (i = 0; i < num_commands - 1; i++)
 	{
 		close(pipes[i][0]);
 		close(pipes[i][1]);
 	}
 
-	/* Wait for all child processes to finish */
-	for (int i = 0; i < num_commands; i++)
+	/* Wait for all child processes; the last one sets $? */
+	for (i = 0; i < started; i++)
+	{
+		status = 0;
+		waitpid(pids[i], &status, 0);
+		if (i == num_commands - 1)
+			shell.status = WIFEXITED(status) ? WEXITSTATUS(status)
+											 : 128 + WTERMSIG(status);
+	}
+	if (started < num_commands)
+		shell.status = 1;
+}
+
+/**
+ * resolve_command - classifies argv[0] as builtin or external, reusing
+ * what the AST node remembers from earlier runs
+ * @n: N_COMMAND node the command was built from
+ * @cmd: built command; gets its builtin flag and path
+ *
+ * Description: the node's answer is reused while argv[0] is the same,
+ * PATH (and the cwd) have not changed and the file is still there;
+ * otherwise PATH is searched again. A name that was not found is
+ * searched for every time, in case it has appeared since.
+ */
+static void resolve_command(node_t *n, command_t *cmd)
+{
+	char *name = cmd->argv[0];
+
+	if (name == NULL)
+		return;
+	if (n->name == NULL || _strcmp(n->name, name) != 0 ||
+		n->path_gen != shell.path_gen ||
+		(!n->builtin && (n->path == NULL || access(n->path, F_OK) != 0)))
+	{
+		free(n->name);
+		free(n->path);
+		n->name = _strdup(name);
+		n->builtin = isBuiltin(name);
+		n->path = n->builtin ? NULL : findPath(name);
+		n->path_gen = shell.path_gen;
+	}
+	cmd->builtin = n->builtin;
+	cmd->path = n->path;
+}
+
+/**
+ * count_stages - counts the commands of a pipeline
+ * @n: N_PIPE, N_COMMAND or N_SUBSHELL node
+ *
+ * Return: number of stages
+ */
+static int count_stages(const node_t *n)
+{
+	return (n->type == N_PIPE ? count_stages(n->left) + 1 : 1);
+}
+
+/**
+ * run_pipe - runs commands connected stdout to stdin by pipes
+ * @n: N_PIPE node; the tree leans left, so the last stage is n->right
+ *
+ * Description: every stage is expanded before anything is forked; $? is
+ * the status of the last stage.
+ */
+static void run_pipe(node_t *n)
+{
+	int num_commands = count_stages(n), i, built = 0, ok = 1;
+	command_t cmds[num_commands];
+	int pipes[num_commands - 1][2];
+	node_t *stages[num_commands];
+
+	for (i = num_commands - 1; i > 0; i--, n = n->left)
+		stages[i] = n->right;
+	stages[0] = n;
+	memset(cmds, 0, sizeof(cmds));
+	for (; built < num_commands; built++)
+	{
+		if (stages[built]->type != N_COMMAND)
+			continue;
+		if (build_command(stages[built], &cmds[built], 0) == -1)
+		{
+			shell.status = 2;
+			ok = 0;
+			break;
+		}
+		resolve_command(stages[built], &cmds[built]);
+	}
+	/* Create all necessary pipes; close-on-exec keeps them out of execve */
+	for (i = 0; ok && i < num_commands - 1; i++)
+		if (pipe2(pipes[i], O_CLOEXEC) < 0)
+		{
+			perror("pipe");
+			while (i-- > 0)
+			{
+				close(pipes[i][0]);
+				close(pipes[i][1]);
+			}
+			ok = 0;
+		}
+	if (ok)
+		run_stages(stages, cmds, pipes, num_commands);
+	finish_process_substitutions();
+}
+
+/**
+ * run_command - expands and runs one simple command
+ * @n: N_COMMAND node
+ * @isAtty: is interactive mode
+ */
+static void run_command(node_t *n, int isAtty)
+{
+	int tail_exec = shell.tail_exec;
+	command_t cmd;
+
+	shell.tail_exec = 0; /* substitutions run commands of their own */
+	shell.subst_status = -1;
+	if (build_command(n, &cmd, 1) == -1)
+		shell.status = 2;
+	else
+	{
+		resolve_command(n, &cmd);
+		shell.tail_exec = tail_exec;
+		executeIfValid(isAtty, &shell.name, &cmd, NULL);
+	}
+	shell.tail_exec = 0;
+	finish_process_substitutions();
+}
+
+static pid_t background[MAX_BACKGROUND];
+static int nbackground;
+
+/**
+ * reap_background - collects background commands that have finished,
+ * without blocking
+ */
+void reap_background(void)
+{
+	int i, j;
+
+	for (i = j = 0; i < nbackground; i++)
+		if (waitpid(background[i], NULL, WNOHANG) == 0)
+			background[j++] = background[i];
+	nbackground = j;
+}
+
+/**
+ * run_background - starts a list item with '&' and does not wait for it
+ * @n: node to run in the child
+ *
+ * Description: as in any shell without job control, the command's stdin
+ * is /dev/null. Its pid is $!; it is reaped before a later line runs.
+ */
+static void run_background(node_t *n)
+{
+	pid_t pid;
+	int fd;
+
+	if (nbackground == MAX_BACKGROUND) /* table full: wait for the oldest */
+	{
+		waitpid(background[0], NULL, 0);
+		memmove(background, background + 1,
+				sizeof(pid_t) * --nbackground);
+	}
+	fflush(NULL);
+	pid = fork();
+	if (pid == -1)
+	{
+		perror("fork");
+		shell.status = 1;
+		return;
+	}
+	if (pid == 0)
+	{
+		fd = open("/dev/null", O_RDONLY);
+		if (fd != -1 && fd != STDIN_FILENO)
+		{
+			dup2(fd, STDIN_FILENO);
+			close(fd);
+		}
+		coproc_close_fds();
+		run_node(n, 0);
+		childExit(shell.status);
+	}
+	background[nbackground++] = pid;
+	shell.last_bg = pid;
+	shell.status = 0;
+}
+
+/**
+ * run_subshell - runs "( list )" in a child, so its cd, exit and
+ * variable changes do not reach the shell
+ * @n: list to run
+ */
+static void run_subshell(node_t *n)
+{
+	pid_t pid;
+	int status = 0;
+
+	fflush(NULL);
+	pid = fork();
+	if (pid == -1)
+	{
+		perror("fork");
+		shell.status = 1;
+		return;
+	}
+	if (pid == 0)
+	{
+		coproc_close_fds();
+		run_node(n, 0);
+		childExit(shell.status);
+	}
+	while (waitpid(pid, &status, 0) == -1 && errno == EINTR)
+		;
+	shell.status = WIFEXITED(status) ? WEXITSTATUS(status)
+									 : 128 + WTERMSIG(status);
+}
+
+/**
+ * run_node - runs an AST
+ * @n: root node
+ * @isAtty: is interactive mode
+ *
+ * Description: "a && b" runs b only if a succeeded and "a || b" only if
+ * it failed; a skipped command leaves $? unchanged.
+ */
+void run_node(node_t *n, int isAtty)
+{
+	switch (n->type)
 	{
-		waitpid(pids[i], NULL, 0);
+	case N_COMMAND:
+		run_command(n, isAtty);
+		break;
+	case N_PIPE:
+		run_pipe(n);
+		break;
+	case N_SEQ:
+		run_node(n->left, isAtty);
+		run_node(n->right, isAtty);
+		break;
+	case N_AND:
+	case N_OR:
+		run_node(n->left, isAtty);
+		if ((shell.status == 0) == (n->type == N_AND))
+			run_node(n->right, isAtty);
+		break;
+	case N_NOT:
+		run_node(n->left, isAtty);
+		shell.status = !shell.status;
+		break;
+	case N_COPROC:
+		shell.status = run_coproc(n);
+		break;
+	case N_BACKGROUND:
+		run_background(n->left);
+		break;
+	case N_SUBSHELL:
+		run_subshell(n->left);
+		break;
 	}
 }
 
 /**
  * execute_command - Executes a single command.
- * @args: The arguments of the command.
- * @path_list: Linked list of PATH directories.
+ * @commandPath: full path of the program
+ * @cmd: parsed command; its redirections are applied in the child
  *
- * Return: 0 on success, appropriate error code on failure.
+ * Return: exit status of the command (128 + signal if it was killed),
+ * -1 if fork failed
  */
-int execute_command(const char *commandPath, char **arguments)
+int execute_command(const char *commandPath, command_t *cmd)
 {
 	pid_t pid;
 	int status;
 
-	// int isCommandRtn = isCommand(commandPath);
-	// printf("\nisCommand: %d\n\n", isCommandRtn);
-	// // if (isCommandRtn)
-	// // 	printf("\nisCommand: %d\n\n", isCommandRtn);
-
+	fflush(stdout);
+	append_cache_prepare(cmd->redirs, cmd->nredirs); /* shared with the child */
 	pid = fork();
 	if (pid == -1)
 	{
@@ -162,30 +379,25 @@ int execute_command(const char *commandPath, char **arguments)
 	else if (pid == 0)
 	{
 		/* Child process */
-		execve(commandPath, arguments, environ);
+		if (apply_redirections(cmd->redirs, cmd->nredirs, NULL) == -1)
+			_exit(EXIT_FAILURE);
+		execve(commandPath, cmd->argv, cmd_envp(cmd));
 		/* perror("execve"); *//* execve failed */
-		exit(EXIT_FAILURE); /* Exit the child! */
+		_exit(126); /* found but not runnable */
 	}
 	else
 	{
 		/* Parent process */
-		if (waitpid(pid, &status, 0) == -1)
-		{
-			perror("waitpid");
-			return WAITPID_ERROR;
-		}
-
-		if (WIFEXITED(status))
+		while (waitpid(pid, &status, 0) == -1)
 		{
-			return WEXITSTATUS(status);
-		}
-		else if (WIFSIGNALED(status))
-		{
-			fprintf(stderr, "Command terminated by signal %d\n", WTERMSIG(status));
-			return -1; /* Or a specific signal error code */
+			if (errno != EINTR)
+			{
+				perror("waitpid");
+				return WAITPID_ERROR;
+			}
 		}
 	}
-	return 0; /* Success */
+	return (WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status));
 }
 
 /**
@@ -212,25 +424,16 @@ int isCommand(const char *fp)
 	temp = head; /* iterator initialization */
 
 	while (temp != NULL) /* run until list is empty */
-	{					 /* malloc space for path/fp\0 */
-		temp_path = malloc(_strlen(temp->directory) + _strlen(fp) + 2);
+	{					 /* space for path/fp\0 */
+		temp_path = arena_alloc(_strlen(temp->directory) + _strlen(fp) + 2);
 		if (temp_path == NULL)
-		{
-			destroyListPath(head);
 			return (-1);
-		}
 		_strcpy(temp_path, temp->directory);
 		_strcat(temp_path, "/");
 		_strcat(temp_path, fp);
 		if (access(temp_path, F_OK) == 0) /* checks if cmd at path exists */
-		{
-			destroyListPath(head); /* frees list of paths */
-			free(temp_path);
 			return (1);	   /* returns found path + fp */
-		}
-		free(temp_path);   /* frees temp_path */
 		temp = temp->next; /* go to next location */
 	}
-	destroyListPath(head);
 	return (0);		   /* not a valid filepath. consider returning errno? */
 }
@@ -0,0 +1,1127 @@
+#include "main.h"
+
+/**
+ * struct fields_s - fields being produced by the expansion of one word
+ * @out: buffer the fields are appended to, each one NUL terminated
+ * @count: number of finished fields
+ * @open: 1 while a field has been started (even an empty quoted one)
+ * @glob: 1 if fields undergo pathname expansion
+ * @meta: 1 once the current field has an unquoted *, ? or [
+ * @start: offset in @out of the current field
+ * @quoted: offsets in @out of the quoted *, ?, [ and \ bytes of the
+ * current field, which the glob pattern must escape
+ * @nquoted: number of entries in @quoted
+ * @cap: capacity of @quoted
+ * @blanks: 1 while expanding the word of an unquoted ${VAR-word}, whose
+ * unquoted blanks separate fields
+ * @pattern: 1 while expanding a pattern, where unquoted expansions keep
+ * their pattern characters and are never split
+ */
+typedef struct fields_s
+{
+	strbuf_t *out;
+	int count;
+	int open;
+	int glob;
+	int meta;
+	size_t start;
+	size_t *quoted;
+	int nquoted;
+	int cap;
+	int blanks;
+	int pattern;
+} fields_t;
+
+static node_t *pattern_node; /* node whose words are being expanded */
+
+static int scan(fields_t *f, const char *p, const char *end, int split,
+				int dq);
+
+/**
+ * add_char - appends one unquoted byte to the current field
+ * @f: fields
+ * @c: byte
+ *
+ * Return: 0 on success, -1 if out of memory
+ */
+static int add_char(fields_t *f, char c)
+{
+	f->open = 1;
+	if (c == '*' || c == '?' || c == '[')
+		f->meta |= f->glob;
+	return (sb_putc(f->out, c));
+}
+
+/**
+ * add_quoted - appends quoted bytes to the current field
+ * @f: fields
+ * @s: bytes
+ * @len: number of bytes
+ *
+ * Description: when the word may be globbed, the pattern characters
+ * among them are remembered so they match only themselves.
+ *
+ * Return: 0 on success, -1 if out of memory
+ */
+static int add_quoted(fields_t *f, const char *s, size_t len)
+{
+	size_t i, *grown;
+
+	f->open = 1;
+	for (i = 0; f->glob && i < len; i++)
+	{
+		if (s[i] != '*' && s[i] != '?' && s[i] != '[' && s[i] != '\\')
+			continue;
+		if (f->nquoted == f->cap)
+		{
+			grown = arena_realloc(f->quoted, sizeof(size_t) * f->cap,
+								  sizeof(size_t) * (f->cap * 2 + 8));
+			if (grown == NULL)
+				return (-1);
+			f->quoted = grown;
+			f->cap = f->cap * 2 + 8;
+		}
+		f->quoted[f->nquoted++] = f->out->len + i;
+	}
+	return (sb_append(f->out, s, len));
+}
+
+/**
+ * pattern_text - turns the current field into a glob pattern
+ * @f: fields, with the current field complete but not yet terminated
+ * @pattern: receives the field, its quoted pattern characters escaped
+ *
+ * Return: 0 on success, -1 if out of memory
+ */
+static int pattern_text(const fields_t *f, strbuf_t *pattern)
+{
+	size_t i;
+	int q = 0;
+
+	for (i = f->start; i < f->out->len; i++)
+	{
+		if (q < f->nquoted && f->quoted[q] == i)
+		{
+			q++;
+			if (sb_putc(pattern, '\\') == -1)
+				return (-1);
+		}
+		if (sb_putc(pattern, f->out->data[i]) == -1)
+			return (-1);
+	}
+	return (sb_reserve(pattern, 0));
+}
+
+/**
+ * glob_field - replaces the current field by the paths it matches
+ * @f: fields, with the current field complete but not yet terminated
+ *
+ * Return: number of paths (the field is then gone), 0 if nothing
+ * matched (the field stays as it is), -1 if out of memory
+ */
+static int glob_field(fields_t *f)
+{
+	strbuf_t pattern = {NULL, 0, 0}, *out = f->out;
+	size_t end = out->len;
+	int n;
+
+	if (pattern_text(f, &pattern) == -1)
+		return (-1);
+	n = glob_expand(pattern.data, out); /* appended after the field */
+	if (n > 0)
+	{
+		memmove(out->data + f->start, out->data + end, out->len - end);
+		out->len = f->start + (out->len - end);
+		out->data[out->len] = '\0';
+	}
+	return (n);
+}
+
+/**
+ * end_field - terminates the current field, if one was started
+ * @f: fields
+ *
+ * Return: 0 on success, -1 if out of memory
+ */
+static int end_field(fields_t *f)
+{
+	int n = 0;
+
+	if (!f->open)
+		return (0);
+	if (f->meta)
+		n = glob_field(f);
+	f->open = 0;
+	f->meta = 0;
+	f->nquoted = 0;
+	if (n == -1)
+		return (-1);
+	if (n > 0)
+		f->count += n;
+	else
+	{
+		f->count++;
+		if (sb_putc(f->out, '\0') == -1)
+			return (-1);
+	}
+	f->start = f->out->len;
+	return (0);
+}
+
+/**
+ * add_text - appends substituted text, splitting it into fields
+ * @f: fields
+ * @s: text
+ * @len: length of @s
+ * @split: 1 if unquoted, so blanks and newlines separate fields
+ *
+ * Return: 0 on success, -1 if out of memory
+ */
+static int add_text(fields_t *f, const char *s, size_t len, int split)
+{
+	size_t i;
+
+	if (!split)
+		return (add_quoted(f, s, len));
+	for (i = 0; i < len; i++)
+	{
+		if (!f->pattern && (s[i] == ' ' || s[i] == '\t' || s[i] == '\n'))
+		{
+			if (end_field(f) == -1)
+				return (-1);
+		}
+		else if (add_char(f, s[i]) == -1)
+			return (-1);
+	}
+	return (0);
+}
+
+/**
+ * add_number - appends a number to the current field
+ * @f: fields
+ * @n: number
+ *
+ * Return: 0 on success, -1 if out of memory
+ */
+static int add_number(fields_t *f, long n)
+{
+	char buf[24];
+
+	return (add_text(f, buf, sprintf(buf, "%ld", n), 0));
+}
+
+/**
+ * add_list - expands a list of values: $@, $*, ${a[@]} or ${a[*]}
+ * @f: fields
+ * @list: values
+ * @n: number of values
+ * @star: 1 for $* and ${a[*]}, 0 for $@ and ${a[@]}
+ * @split: 1 if unquoted
+ *
+ * Description: unquoted, every value is split on its own. "$@" gives
+ * one field per value, empty ones included; "$*" joins them with
+ * spaces into the current field. The values are copied straight into
+ * their fields, so an array element is never split again when quoted.
+ *
+ * Return: 0 on success, -1 if out of memory
+ */
+static int add_list(fields_t *f, char *const *list, int n, int star,
+					int split)
+{
+	int i, rtn = 0;
+
+	for (i = 0; i < n && rtn == 0; i++)
+	{
+		if (i > 0 && star && !split)
+			rtn = add_char(f, ' ');
+		else if (i > 0)
+		{
+			f->open |= !split;
+			rtn = end_field(f);
+		}
+		f->open |= !split;
+		if (rtn == 0)
+			rtn = add_text(f, list[i], _strlen(list[i]), split);
+	}
+	return (rtn);
+}
+
+/**
+ * param_value - the value of a variable or positional parameter
+ * @name: a variable name or a positional number
+ * @len: length of @name
+ *
+ * Return: the value, NULL if it is not set
+ */
+static const char *param_value(const char *name, size_t len)
+{
+	size_t i, n = 0;
+
+	if (!isdigit((unsigned char)*name))
+		return (_getenv(arena_strdup(name, len)));
+	for (i = 0; i < len; i++)
+		n = n * 10 + (name[i] - '0');
+	if (n == 0)
+		return (shell.name);
+	return (n <= (size_t)shell.argc ? shell.argv[n - 1] : NULL);
+}
+
+/**
+ * add_param - appends the value of a parameter to the current field
+ * @f: fields
+ * @name: a variable name, a positional number or one of ? $ ! # @ *
+ * @len: length of @name
+ * @split: 1 if unquoted, so the value is split into fields
+ *
+ * Return: 0 on success (an unset parameter adds nothing), -1 if out
+ * of memory
+ */
+static int add_param(fields_t *f, const char *name, size_t len, int split)
+{
+	const char *value;
+
+	if (len == 1)
+		switch (*name)
+		{
+		case '?':
+			return (add_number(f, shell.status));
+		case '$':
+			return (add_number(f, shell.pid));
+		case '#':
+			return (add_number(f, shell.argc));
+		case '!':
+			return (shell.last_bg ? add_number(f, shell.last_bg) : 0);
+		case '@':
+		case '*':
+			return (add_list(f, shell.argv, shell.argc, *name == '*', split));
+		}
+	value = param_value(name, len);
+	return (value ? add_text(f, value, _strlen(value), split) : 0);
+}
+
+/**
+ * param_end - finds the end of the parameter name that follows a '$'
+ * @p: text just after the '$' (or the "${")
+ * @end: end of the text
+ * @braced: 1 inside ${...}, where positionals can have several digits
+ *
+ * Return: pointer past the name, @p if there is none
+ */
+static const char *param_end(const char *p, const char *end, int braced)
+{
+	if (p < end && isdigit((unsigned char)*p) && braced)
+		while (p < end && isdigit((unsigned char)*p))
+			p++;
+	else if (p < end && _strchr("?$!#@*0123456789", *p) != NULL)
+		p++;
+	else if (p < end && (isalpha((unsigned char)*p) || *p == '_'))
+		while (p < end && (isalnum((unsigned char)*p) || *p == '_'))
+			p++;
+	return (p);
+}
+
+/**
+ * element_value - looks up ${NAME[subscript]}
+ * @name: NAME
+ * @sub: subscript text, before expansion
+ * @len: length of @sub
+ * @value: receives the element, NULL if it is not set
+ *
+ * Description: a variable that is not an array acts as one whose only
+ * element is 0.
+ *
+ * Return: 0 on success, -1 if out of memory or the subscript is not an
+ * index (message printed)
+ */
+static int element_value(char *name, const char *sub, size_t len,
+						 const char **value)
+{
+	array_t *a = var_array(name, 0);
+	strbuf_t key = {NULL, 0, 0};
+	size_t index;
+
+	*value = NULL;
+	if (expand_word(sub, len, &key, 0) == -1)
+		return (-1);
+	if (a != NULL && array_is_assoc(a))
+		*value = array_get(a, key.data, 0);
+	else if (array_subscript(a, key.data, &index) == -1)
+	{
+		fprintf(stderr, "%s: 1: %s[%s]: bad array subscript\n", shell.name,
+				name, key.data);
+		return (-1);
+	}
+	else if (a != NULL)
+		*value = array_get(a, NULL, index);
+	else if (index == 0)
+		*value = _getenv(name);
+	return (0);
+}
+
+/**
+ * add_element - expands ${NAME[subscript]}, ${NAME[@]} and ${NAME[*]},
+ * or with a leading # their length, or with a leading ! their keys
+ * @f: fields
+ * @name: NAME
+ * @sub: subscript text, before expansion
+ * @len: length of @sub
+ * @op: '#', '!' or 0
+ * @split: 1 if unquoted
+ *
+ * Description: a variable that is not an array acts as one whose only
+ * element is 0.
+ *
+ * Return: 0 on success, -1 if out of memory
+ */
+static int add_element(fields_t *f, char *name, const char *sub, size_t len,
+					   int op, int split)
+{
+	array_t *a = var_array(name, 0);
+	char *scalar[2] = {NULL, NULL}, **list = scalar;
+	const char *value = NULL;
+	int n;
+
+	if (a == NULL)
+		scalar[0] = op == '!' ? (_getenv(name) ? "0" : NULL) : _getenv(name);
+	if (len == 1 && (*sub == '@' || *sub == '*'))
+	{
+		list = a != NULL ? array_list(a, op == '!') : scalar;
+		if (list == NULL)
+			return (-1);
+		for (n = 0; list[n] != NULL; n++)
+			;
+		if (op == '#')
+			return (add_number(f, n));
+		return (add_list(f, list, n, *sub == '*', split));
+	}
+	if (element_value(name, sub, len, &value) == -1)
+		return (-1);
+	if (op == '#')
+		return (add_number(f, value ? _strlen(value) : 0));
+	return (value ? add_text(f, value, _strlen(value), split) : 0);
+}
+
+/**
+ * expand_node - sets the AST node whose words are being expanded
+ * @n: node, NULL for text that is not part of a cached tree
+ *
+ * Return: the node that was set before, to be put back afterwards
+ */
+node_t *expand_node(node_t *n)
+{
+	node_t *prev = pattern_node;
+
+	pattern_node = n;
+	return (prev);
+}
+
+/**
+ * get_pattern - expands and compiles the pattern of a ${VAR#pattern}
+ * @w: pattern text, quotes and escapes still in place
+ * @end: its end
+ * @n: receives the number of ops
+ *
+ * Description: quoted characters in the pattern only match themselves.
+ * A pattern with no $ or ` in it is the same every time the command
+ * runs, so its ops are kept by the node being expanded, keyed on where
+ * the text is in the node's tokens, and found there the next time.
+ *
+ * Return: compiled pattern, NULL if out of memory
+ */
+static glob_op_t *get_pattern(const char *w, const char *end, int *n)
+{
+	fields_t f = {NULL, 0, 1, 1, 0, 0, NULL, 0, 0, 0, 1};
+	strbuf_t text = {NULL, 0, 0}, pattern = {NULL, 0, 0};
+	node_t *node = pattern_node;
+	pattern_t *pat;
+	glob_op_t *ops;
+	size_t len = end - w, i;
+
+	for (i = 0; node != NULL && i < len; i++)
+		if (w[i] == '$' || w[i] == '`' || w[i] == '~')
+			node = NULL;
+	if (node != NULL && (node->ntok == 0 || w < node->tok[0].start ||
+		end > node->tok[node->ntok - 1].start + node->tok[node->ntok - 1].len))
+		node = NULL;
+	for (pat = node != NULL ? node->patterns : NULL; pat; pat = pat->next)
+		if (pat->src == w && pat->len == len)
+		{
+			*n = pat->nops;
+			return (pat->ops);
+		}
+	f.out = &text;
+	if (scan(&f, w, end, 1, 0) == -1 || pattern_text(&f, &pattern) == -1)
+		return (NULL);
+	ops = glob_compile(pattern.data, pattern.data + pattern.len, n);
+	pat = node != NULL && ops != NULL ? malloc(sizeof(pattern_t)) : NULL;
+	if (pat != NULL)
+	{
+		pat->ops = glob_keep(ops, *n);
+		if (pat->ops == NULL)
+			free(pat);
+		else
+		{
+			pat->src = w;
+			pat->len = len;
+			pat->nops = *n;
+			pat->next = node->patterns;
+			node->patterns = pat;
+		}
+	}
+	return (ops);
+}
+
+/**
+ * find_match - finds where a pattern matches a value
+ * @ops: compiled pattern
+ * @n: number of ops
+ * @s: value
+ * @len: length of @s
+ * @how: '#' for a prefix, '%' for a suffix, '/' for the leftmost match
+ * starting at or after @at (and not empty)
+ * @longest: 1 for the longest match, 0 for the shortest ('/' is always
+ * longest)
+ * @at: start of the search; receives where the match starts
+ *
+ * Description: a pattern without * can only match as many bytes as it
+ * has ops, which is the one length tried.
+ *
+ * Return: length of the match, -1 if there is none
+ */
+static long find_match(const glob_op_t *ops, int n, const char *s, size_t len,
+					   int how, int longest, size_t *at)
+{
+	size_t start = how == '/' ? *at : 0, lo, hi, k;
+	int i, fixed = 1;
+
+	for (i = 0; i < n; i++)
+		fixed &= ops[i].type != GLOB_STAR;
+	for (; start <= len; start++)
+	{
+		lo = how == '/' ? 1 : 0;
+		hi = len - start;
+		if (fixed && ((size_t)n < lo || (size_t)n > hi))
+			lo = 1, hi = 0; /* nothing to try */
+		else if (fixed)
+			lo = hi = (size_t)n;
+		for (k = longest || how == '/' ? hi : lo; k >= lo && k <= hi;
+			 k = longest || how == '/' ? k - 1 : k + 1)
+		{
+			*at = how == '%' ? len - k : start;
+			if (glob_match_n(ops, n, s + *at, k))
+				return ((long)k);
+		}
+		if (how != '/')
+			break;
+	}
+	return (-1);
+}
+
+/**
+ * word_end - finds the end of one part of a ${VAR/pattern/string} or
+ * ${VAR:offset:length}
+ * @p: start of the part
+ * @end: end of the text inside the braces
+ * @sep: byte that ends the part, '/' or ':'
+ *
+ * Return: pointer to the separator, @end if there is none
+ */
+static const char *word_end(const char *p, const char *end, char sep)
+{
+	for (; p != NULL && p < end && *p != sep; p++)
+		if (*p == '\\' && p + 1 < end)
+			p++;
+		else if (*p == '\'')
+			p = _strchr(p + 1, '\'');
+		else if (*p == '"')
+		{
+			for (p++; p < end && *p != '"'; p++)
+				if (*p == '\\' && p + 1 < end)
+					p++;
+		}
+		else if (*p == '$' && (p[1] == '{' || p[1] == '('))
+			p = p[1] == '{' ? find_closing_brace(p + 2)
+							: find_closing_paren((char *)p + 2);
+	return (p != NULL && p < end ? p : end);
+}
+
+/**
+ * parse_offset - reads the offset or length of a ${VAR:offset:length}
+ * @w: text, before expansion
+ * @end: its end
+ * @n: receives the number
+ *
+ * Return: 0 on success, -1 if it is not an integer (message printed)
+ */
+static int parse_offset(const char *w, const char *end, long *n)
+{
+	strbuf_t text = {NULL, 0, 0};
+	char *p, *stop;
+
+	if (expand_word(w, end - w, &text, 0) == -1)
+		return (-1);
+	for (p = text.data; *p == ' ' || *p == '\t'; p++)
+		;
+	errno = 0;
+	*n = strtol(p, &stop, 10);
+	while (*stop == ' ' || *stop == '\t')
+		stop++;
+	if (stop != p && *stop == '\0' && errno == 0)
+		return (0);
+	fprintf(stderr, "%s: 1: %s: bad number\n", shell.name, text.data);
+	return (-1);
+}
+
+/**
+ * add_substring - expands ${VAR:offset} and ${VAR:offset:length}
+ * @f: fields
+ * @value: value of VAR, NULL if unset
+ * @op: the ':'
+ * @end: the closing brace
+ * @split: 1 if unquoted
+ *
+ * Description: a negative offset counts from the end of the value, a
+ * negative length leaves that many bytes off its end.
+ *
+ * Return: 0 on success, -1 on error (message already printed)
+ */
+static int add_substring(fields_t *f, const char *value, const char *op,
+						 const char *end, int split)
+{
+	const char *mid = word_end(op + 1, end, ':');
+	long len = value ? (long)_strlen(value) : 0, off, n;
+
+	if (parse_offset(op + 1, mid, &off) == -1 ||
+		(mid < end && parse_offset(mid + 1, end, &n) == -1))
+		return (-1);
+	off = off < 0 ? off + len : off;
+	if (off < 0 || off > len)
+		return (0);
+	n = mid == end ? len - off : n < 0 ? len - off + n : n;
+	if (n < 0)
+	{
+		fprintf(stderr, "%s: 1: %.*s: substring expression < 0\n",
+				shell.name, (int)(end - mid - 1), mid + 1);
+		return (-1);
+	}
+	return (add_text(f, value + off, n < len - off ? n : len - off, split));
+}
+
+/**
+ * add_slice - expands ${NAME[@]:offset} and ${NAME[@]:offset:length}
+ * (or [*])
+ * @f: fields
+ * @name: NAME
+ * @op: the ':'
+ * @end: the closing brace
+ * @star: 1 for [*]
+ * @split: 1 if unquoted
+ *
+ * Description: as in bash, the offset of an indexed array is an index
+ * (negative: counted back from one past the highest), the slice starts
+ * at the first element set there or after it, and the length counts
+ * elements. An associative array, or a scalar, is sliced by position.
+ *
+ * Return: 0 on success, -1 on error (message already printed)
+ */
+static int add_slice(fields_t *f, char *name, const char *op,
+					 const char *end, int star, int split)
+{
+	array_t *a = var_array(name, 0);
+	const char *mid = word_end(op + 1, end, ':');
+	char *scalar[2] = {NULL, NULL}, **list = scalar, **keys = NULL;
+	long off, n = 0, count, first, total;
+
+	if (parse_offset(op + 1, mid, &off) == -1 ||
+		(mid < end && parse_offset(mid + 1, end, &n) == -1))
+		return (-1);
+	if (mid < end && n < 0)
+	{
+		fprintf(stderr, "%s: 1: %.*s: substring expression < 0\n",
+				shell.name, (int)(end - mid - 1), mid + 1);
+		return (-1);
+	}
+	scalar[0] = a == NULL ? _getenv(name) : NULL;
+	list = a != NULL ? array_list(a, 0) : scalar;
+	keys = a != NULL && !array_is_assoc(a) ? array_list(a, 1) : NULL;
+	if (list == NULL || (a != NULL && !array_is_assoc(a) && keys == NULL))
+		return (-1);
+	for (count = 0; list[count] != NULL; count++)
+		;
+	total = keys != NULL ? (long)array_length(a) : count;
+	off = off < 0 ? off + total : off;
+	if (off < 0)
+		return (0);
+	for (first = 0; first < count &&
+		 (keys != NULL ? strtol(keys[first], NULL, 10) : first) < off;)
+		first++;
+	n = mid == end || n > count - first ? count - first : n;
+	return (add_list(f, list + first, n, star, split));
+}
+
+/**
+ * add_trimmed - expands ${VAR#pattern}, ${VAR##pattern}, ${VAR%pattern}
+ * and ${VAR%%pattern}
+ * @f: fields
+ * @value: value of VAR, NULL if unset
+ * @op: the first '#' or '%'
+ * @end: the closing brace
+ * @split: 1 if unquoted
+ *
+ * Description: what is left is a slice of the value, added straight to
+ * the field.
+ *
+ * Return: 0 on success, -1 if out of memory
+ */
+static int add_trimmed(fields_t *f, const char *value, const char *op,
+					   const char *end, int split)
+{
+	int longest = op[1] == *op, n;
+	glob_op_t *ops = get_pattern(op + 1 + longest, end, &n);
+	size_t len = value ? _strlen(value) : 0, at = 0;
+	long k;
+
+	if (ops == NULL)
+		return (-1);
+	if (value == NULL)
+		return (0);
+	k = find_match(ops, n, value, len, *op, longest, &at);
+	if (k > 0 && *op == '#')
+		value += k, len -= k;
+	else if (k > 0)
+		len = at;
+	return (add_text(f, value, len, split));
+}
+
+/**
+ * add_replaced - expands ${VAR/pattern/string}: the longest match of
+ * pattern is replaced by string; // replaces every match, /# a match
+ * at the start and /% one at the end
+ * @f: fields
+ * @value: value of VAR, NULL if unset
+ * @op: the first '/'
+ * @end: the closing brace
+ * @split: 1 if unquoted
+ *
+ * Description: the unmatched slices of the value and the replacement
+ * are appended to the field in turn; no intermediate string is built.
+ *
+ * Return: 0 on success, -1 if out of memory
+ */
+static int add_replaced(fields_t *f, const char *value, const char *op,
+						const char *end, int split)
+{
+	int how = op[1] == '#' || op[1] == '%' ? op[1] : '/', all = op[1] == '/';
+	const char *p = op + 1 + (how != '/' || all), *sep = word_end(p, end, '/');
+	strbuf_t rep = {NULL, 0, 0};
+	size_t len, from = 0, at;
+	glob_op_t *ops;
+	long k;
+	int rtn = 0, n;
+
+	ops = get_pattern(p, sep, &n);
+
+	if (ops == NULL || (sep < end &&
+		expand_word(sep + 1, end - sep - 1, &rep, 0) == -1))
+		return (-1);
+	if (value == NULL)
+		return (0);
+	len = _strlen(value);
+	do {
+		at = from;
+		k = find_match(ops, n, value, len, how, 1, &at);
+		if (k < 0)
+			break;
+		rtn = add_text(f, value + from, at - from, split);
+		if (rtn == 0 && rep.data != NULL)
+			rtn = add_text(f, rep.data, _strlen(rep.data), split);
+		from = at + k;
+	} while (all && rtn == 0 && from < len);
+	return (rtn ? rtn : add_text(f, value + from, len - from, split));
+}
+
+/**
+ * add_default - expands ${VAR-word}, ${VAR=word}, ${VAR+word} and
+ * ${VAR?word}, and the forms with a ':' that also treat an empty VAR as
+ * unset
+ * @f: fields
+ * @name: VAR
+ * @value: its value, NULL if unset
+ * @op: the operator, after any ':'
+ * @colon: 1 if there was a ':'
+ * @end: the closing brace
+ * @split: 1 unless the ${...} is a redirection target
+ * @dq: 1 inside double quotes
+ *
+ * Description: a word that is used is expanded into the field like the
+ * rest of the text, so it is split and globbed when unquoted.
+ *
+ * Return: 0 on success, -1 on error (message already printed)
+ */
+static int add_default(fields_t *f, const char *name, const char *value,
+					   const char *op, int colon, const char *end, int split,
+					   int dq)
+{
+	int set = value != NULL && (!colon || *value != '\0'), blanks, rtn;
+	strbuf_t text = {NULL, 0, 0};
+
+	if (set && *op != '+')
+		return (add_text(f, value, _strlen(value), split && !dq));
+	if (*op == '+' || *op == '-')
+	{
+		if (set != (*op == '+'))
+			return (0);
+		blanks = f->blanks;
+		f->blanks = split && !dq;
+		rtn = scan(f, op + 1, end, split, dq);
+		f->blanks = blanks;
+		return (rtn);
+	}
+	if (expand_word(op + 1, end - op - 1, &text, 0) == -1)
+		return (-1);
+	if (*op == '?')
+		fprintf(stderr, "%s: 1: %s: %s\n", shell.name, name,
+				*text.data ? text.data : "parameter not set");
+	else if (!isalpha((unsigned char)*name) && *name != '_')
+		fprintf(stderr, "%s: 1: %s: cannot assign in this way\n",
+				shell.name, name);
+	else if (var_set(name, text.data) == 0)
+		return (add_text(f, text.data, _strlen(text.data), split && !dq));
+	return (-1);
+}
+
+/**
+ * bad_substitution - reports a ${...} that can't be expanded
+ * @p: text just after "${"
+ * @close: the closing brace
+ *
+ * Return: -1
+ */
+static int bad_substitution(const char *p, const char *close)
+{
+	fprintf(stderr, "%s: 1: ${%.*s}: bad substitution\n", shell.name,
+			(int)(close - p), p);
+	return (-1);
+}
+
+/**
+ * add_operator - expands a ${NAME<operator>...} or
+ * ${NAME[subscript]<operator>...}
+ * @f: fields
+ * @name: NAME, or a special or positional parameter
+ * @sub: subscript text, NULL if there is none
+ * @sublen: length of @sub
+ * @op: the operator
+ * @close: the closing brace
+ * @split: 1 unless the ${...} is a redirection target
+ * @dq: 1 inside double quotes
+ *
+ * Return: 0 on success, -1 on error (message already printed)
+ */
+static int add_operator(fields_t *f, char *name, const char *sub,
+						size_t sublen, const char *op, const char *close,
+						int split, int dq)
+{
+	const char *value = NULL;
+	char num[24];
+	int colon = *op == ':' && op + 1 < close && _strchr("-=+?", op[1]);
+
+	if (sub != NULL && element_value(name, sub, sublen, &value) == -1)
+		return (-1);
+	if (sub == NULL && name[1] == '\0' && _strchr("?$!#", *name))
+	{
+		value = num;
+		sprintf(num, "%ld", *name == '?' ? (long)shell.status :
+				*name == '$' ? (long)shell.pid : *name == '#' ?
+				(long)shell.argc : (long)shell.last_bg);
+		if (*name == '!' && shell.last_bg == 0)
+			value = NULL;
+	}
+	else if (sub == NULL)
+		value = param_value(name, _strlen(name));
+	if (colon || _strchr("-=+?", *op))
+		return (add_default(f, name, value, op + colon, colon, close, split,
+							dq));
+	if (*op == ':')
+		return (add_substring(f, value, op, close, split && !dq));
+	if (*op == '#' || *op == '%')
+		return (add_trimmed(f, value, op, close, split && !dq));
+	return (add_replaced(f, value, op, close, split && !dq));
+}
+
+/**
+ * add_braced - expands ${NAME}, ${#NAME}, the array forms and the
+ * operators
+ * @f: fields
+ * @p: text just after "${"
+ * @close: the closing brace
+ * @split: 1 unless the ${...} is a redirection target
+ * @dq: 1 inside double quotes
+ *
+ * Return: 0 on success, -1 on error (message already printed)
+ */
+static int add_braced(fields_t *f, const char *p, const char *close,
+					  int split, int dq)
+{
+	const char *start = p, *name_end, *sub = NULL, *rest, *value;
+	char *name;
+	int op = 0, all, slice;
+
+	if ((*p == '#' || *p == '!') && param_end(p + 1, close, 1) != p + 1)
+		op = *p++;
+	rest = name_end = param_end(p, close, 1);
+	if (name_end < close && *name_end == '[' &&
+		(isalpha((unsigned char)*p) || *p == '_'))
+	{
+		sub = name_end + 1;
+		rest = memchr(sub, ']', close - sub);
+		rest = rest != NULL ? rest + 1 : NULL;
+	}
+	all = sub != NULL && rest == sub + 2 && (*sub == '@' || *sub == '*');
+	slice = all && rest != close && *rest == ':' &&
+			(rest + 1 == close || !_strchr("-=+?", rest[1]));
+	if (name_end == p || rest == NULL || (sub != NULL && rest == sub + 1) ||
+		(op == '!' && sub == NULL) || (op && rest != close) ||
+		(rest != close && _strchr(":-=+?#%/", *rest) == NULL) ||
+		(rest != close && !slice && (sub ? all : name_end - p == 1 &&
+		 (*p == '@' || *p == '*'))))
+		return (bad_substitution(start, close));
+	name = arena_strdup(p, name_end - p);
+	if (name == NULL)
+		return (-1);
+	if (slice)
+		return (add_slice(f, name, rest, close, *sub == '*', split && !dq));
+	if (rest != close)
+		return (add_operator(f, name, sub, sub ? rest - 1 - sub : 0, rest,
+							 close, split, dq));
+	if (sub != NULL)
+		return (add_element(f, name, sub, rest - 1 - sub, op, split && !dq));
+	if (op == '#' && close - p == 1 && (*p == '@' || *p == '*'))
+		return (add_number(f, shell.argc));
+	if (op == '#' && _strchr("?$!#", *p) == NULL)
+	{
+		value = param_value(p, close - p);
+		return (add_number(f, value ? _strlen(value) : 0));
+	}
+	if (op == '#')
+		return (0);
+	return (add_param(f, p, close - p, split && !dq));
+}
+
+/**
+ * add_tilde - expands a leading ~ (HOME) or ~user (their home directory)
+ * @f: fields
+ * @w: word, starting with '~'
+ * @end: end of the word
+ *
+ * Return: pointer past the expanded prefix, @w if it is kept literally
+ * (quoted characters in it, unknown user, HOME unset), NULL if out of
+ * memory
+ */
+static const char *add_tilde(fields_t *f, const char *w, const char *end)
+{
+	const char *p = w + 1;
+	struct passwd *pw;
+	char *dir = NULL;
+
+	for (; p < end && *p != '/'; p++)
+		if (!isalnum((unsigned char)*p) && _strchr("_-.", *p) == NULL)
+			return (w);
+	if (p == w + 1)
+		dir = _getenv("HOME");
+	else
+	{
+		pw = getpwnam(arena_strdup(w + 1, p - w - 1));
+		dir = pw != NULL ? pw->pw_dir : NULL;
+	}
+	if (dir == NULL)
+		return (w);
+	f->open = 1;
+	return (add_text(f, dir, _strlen(dir), 0) == -1 ? NULL : p);
+}
+
+/**
+ * substitute_slice - runs a $(...), `...` or <(...) body and adds the
+ * result to the current field
+ * @f: fields
+ * @body: inner command text
+ * @len: length of @body
+ * @kind: '$' or '`' for command substitution, '<' or '>' for process
+ * substitution
+ * @split: 1 if the result is unquoted
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int substitute_slice(fields_t *f, const char *body, size_t len,
+							char kind, int split)
+{
+	strbuf_t text = {NULL, 0, 0}, output = {NULL, 0, 0};
+	char path[32];
+	size_t i;
+	int rtn = -1, fd;
+
+	for (i = 0; i < len; i++) /* in `...`, \` \\ and \$ lose the backslash */
+	{
+		if (kind == '`' && body[i] == '\\' && i + 1 < len &&
+			(body[i + 1] == '`' || body[i + 1] == '\\' || body[i + 1] == '$'))
+			i++;
+		if (sb_putc(&text, body[i]) == -1)
+			return (-1);
+	}
+	if (sb_reserve(&text, 0) == -1)
+		return (-1);
+	if (kind == '<' || kind == '>')
+	{
+		fd = proc_subst_open(text.data, kind);
+		if (fd != -1)
+			rtn = add_text(f, path, sprintf(path, "/dev/fd/%d", fd), 0);
+	}
+	else if (command_substitute(text.data, &output) == 0)
+		rtn = add_text(f, output.data, output.len, split);
+	return (rtn);
+}
+
+/**
+ * empty_list - tells whether a word is just "$@" or "${NAME[@]}" with
+ * nothing to expand to, which gives no field at all
+ * @w: word text
+ * @len: its length
+ *
+ * Return: 1 if so, 0 otherwise
+ */
+static int empty_list(const char *w, size_t len)
+{
+	array_t *a;
+	char *name;
+
+	if (len == 4 && memcmp(w, "\"$@\"", 4) == 0)
+		return (shell.argc == 0);
+	if (len < 9 || memcmp(w, "\"${", 3) != 0 ||
+		memcmp(w + len - 5, "[@]}\"", 5) != 0 ||
+		param_end(w + 3, w + len - 5, 0) != w + len - 5)
+		return (0);
+	name = arena_strdup(w + 3, len - 8);
+	if (name == NULL)
+		return (0);
+	a = var_array(name, 0);
+	return (a != NULL ? array_count(a) == 0 : _getenv(name) == NULL);
+}
+
+/**
+ * scan - expands text into the fields, left to right
+ * @f: fields
+ * @p: text, quotes and escapes still in place
+ * @end: its end
+ * @split: 1 to split unquoted expansion output into several fields
+ * @dq: 1 if the text starts inside double quotes
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int scan(fields_t *f, const char *p, const char *end, int split,
+				int dq)
+{
+	const char *w = p, *close;
+	int rtn = 0;
+
+	while (p < end && rtn == 0)
+	{
+		if (*p == '\'' && !dq)
+		{
+			close = _strchr(p + 1, '\'');
+			rtn = add_quoted(f, p + 1, close - p - 1);
+			p = close + 1;
+		}
+		else if (*p == '"')
+		{
+			dq = !dq;
+			f->open = 1;
+			p++;
+		}
+		else if (*p == '\\' && p + 1 < end &&
+				 (!dq || _strchr("$`\"\\\n", p[1]) != NULL))
+		{
+			if (p[1] != '\n') /* backslash-newline is a line continuation */
+				rtn = add_quoted(f, p + 1, 1);
+			p += 2;
+		}
+		else if ((*p == '$' && p[1] == '(') ||
+				 ((*p == '<' || *p == '>') && p[1] == '(' && p == w))
+		{
+			close = find_closing_paren((char *)p + 2);
+			rtn = substitute_slice(f, p + 2, close - p - 2, *p, split && !dq);
+			p = close + 1;
+		}
+		else if (*p == '`')
+		{
+			for (close = p + 1; *close != '`'; close++)
+				if (*close == '\\' && close[1])
+					close++;
+			rtn = substitute_slice(f, p + 1, close - p - 1, '`', split && !dq);
+			p = close + 1;
+		}
+		else if (*p == '$' && p[1] == '{')
+		{
+			close = find_closing_brace(p + 2);
+			rtn = add_braced(f, p + 2, close, split, dq);
+			p = close + 1;
+		}
+		else if (*p == '$' && param_end(p + 1, end, 0) != p + 1)
+		{
+			close = param_end(p + 1, end, 0);
+			rtn = add_param(f, p + 1, close - p - 1, split && !dq);
+			p = close;
+		}
+		else if (f->blanks && !dq && (*p == ' ' || *p == '\t' || *p == '\n'))
+			rtn = end_field(f), p++;
+		else
+		{
+			rtn = dq ? add_quoted(f, p, 1) : add_char(f, *p);
+			p++;
+		}
+	}
+	return (rtn);
+}
+
+/**
+ * expand_word - quote removal, expansions and field splitting for one
+ * word, in a single left-to-right pass
+ * @w: word text, quotes and escapes still in place
+ * @len: length of @w
+ * @out: buffer the resulting fields are appended to, each NUL terminated
+ * @split: 1 to split unquoted expansion output into several fields,
+ * 0 to always produce exactly one field (redirection targets)
+ *
+ * Description: handles a leading ~ or ~user, $NAME, ${NAME}, ${#NAME},
+ * the operators ${NAME:-word}, ${NAME:=word}, ${NAME:+word}, ${NAME:?word}
+ * (and without the ':'), ${NAME#pat}, ${NAME##pat}, ${NAME%pat},
+ * ${NAME%%pat}, ${NAME/pat/str}, ${NAME:off:len}, the array forms
+ * ${NAME[i]}, ${NAME[@]}, ${#NAME[@]} and ${!NAME[@]}, the special
+ * parameters $? $$ $! $# $@ $* and $0-$9, $(...), `...` and a leading
+ * <(...) or >(...). Values are appended straight to @out as they are
+ * met, so each byte of the word is looked at once. With @split, a field
+ * holding an unquoted *, ? or [ is replaced by the paths it matches,
+ * if any.
+ *
+ * Return: number of fields added, -1 on error
+ */
+int expand_word(const char *w, size_t len, strbuf_t *out, int split)
+{
+	fields_t f = {NULL, 0, 0, 0, 0, 0, NULL, 0, 0, 0, 0};
+	const char *p = w, *end = w + len;
+
+	f.out = out;
+	f.open = !split;
+	f.glob = split; /* not redirection targets */
+	f.start = out->len;
+	if (split && empty_list(w, len))
+		return (0); /* "$@" without parameters is no field at all */
+	if (*w == '~')
+	{
+		p = add_tilde(&f, w, end);
+		if (p == NULL)
+			return (-1);
+	}
+	if (scan(&f, p, end, split, 0) == -1 || end_field(&f) == -1)
+		return (-1);
+	return (f.count);
+}
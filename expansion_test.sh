@@ -0,0 +1,79 @@
+#!/bin/bash
+
+# Test cases for expansions, arrays, batching and scripts in your custom
+# shell. This script assumes your shell is named 'hsh' and is in the
+# current directory.
+
+HSH="$(pwd)/hsh"
+TMP=$(mktemp -d)
+failed=0
+
+# --- Helper Function ---
+run_test() {
+    local test_num=$1
+    local command=$2
+    local expected_output=$3
+    local expected_exit_code=$4
+
+    output=$(cd "$TMP" && "$HSH" -c "$command" 2>&1)
+    actual_exit_code=$?
+
+    if [ "$output" = "$(printf "$expected_output")" ] &&
+       [ "$actual_exit_code" -eq "$expected_exit_code" ]; then
+        echo "Test $test_num: PASSED"
+    else
+        echo "Test $test_num: FAILED: $command"
+        echo "  expected '$expected_output' ($expected_exit_code)"
+        echo "  got      '$output' ($actual_exit_code)"
+        failed=1
+    fi
+}
+
+# --- Test Cases ---
+
+# Parameter expansion operators
+run_test 1 'x=/usr/lib/file.tar.gz; echo ${x##*/} ${x%%.*} ${x/lib/LIB} ${x:5:3}' \
+    "file.tar.gz /usr/lib/file /usr/LIB/file.tar.gz lib" 0
+run_test 2 'echo ${u:-def} ${u-set}; u=; echo "[${u:+alt}]" ${u:=now}; echo $u' \
+    "def set\n[] now\nnow" 0
+run_test 3 'echo $(echo ${x:=5}); echo "[$x]"' "5\n[]" 0
+run_test 4 'echo $(echo \)) $(echo "a\")")' ') a")' 0
+
+# Assignments and $?
+run_test 5 'X=1 Y=$X; echo "[$Y]"' "[1]" 0
+run_test 6 'x=$(false); echo $?; x=$(exit 3); echo $?' "1\n3" 0
+
+# Arrays
+run_test 7 'a=(p "q r" s); echo ${#a[@]} ${a[1]} ${a[-1]}; echo "${a[@]:1:1}"' \
+    "3 q r s\nq r" 0
+run_test 8 'declare -A m; m[k]=v; m[j]=w; echo ${m[k]} ${!m[@]}' "v k j" 0
+run_test 9 'a=(1 2); echo ${a[i+1]}' "$HSH: 1: a[i+1]: bad array subscript" 2
+
+# declare takes NAME=(...) like a plain array assignment
+run_test 10 'declare -a a=(1 "2 3"); echo ${#a[@]} ${a[1]}' "2 2 3" 0
+run_test 11 'declare -A m=([k]=v [j]=w); echo ${m[k]} ${m[j]}' "v w" 0
+run_test 12 'declare -x Z=1; env | grep ^Z=; declare -p Z; declare -q w' \
+    "Z=1\ndeclare -x Z='1'\n$HSH: 1: declare: usage: declare [-aAxp] [NAME[=value]]..." 2
+
+# read without -r handles backslashes; a last line with no newline is EOF
+run_test 13 "printf 'a\\\\ b c\\n' >r; read x y <r; echo \"[\$x][\$y]\"; read -r x <r; echo \"[\$x]\"" \
+    "[a b][c]\n[a\\\\ b c]" 0
+run_test 14 "printf 'a\\nb' >r; exec 7<r; read -u 7 l; echo \$? \$l; read -u 7 l; echo \$? \$l" \
+    "0 a\n1 b" 0
+
+# coproc without a NAME is COPROC
+run_test 15 'coproc cat; echo hi >&$COPROC_1; read -u $COPROC_0 x; echo "[$x]"' "[hi]" 0
+
+# ** does not descend through symlinks
+run_test 16 'mkdir -p a/b d; touch a/x.c a/b/y.c; ln -s ../a d/link; echo **/*.c' \
+    "a/b/y.c a/x.c" 0
+
+# batch splits an argument list past ARG_MAX
+run_test 17 'batch /bin/echo $(seq 1 150000) | wc -w' "150000" 0
+
+# A script with subshells runs each line once
+run_test 18 "printf 'echo a\\n(true)\\nx=\$(echo q; true)\\necho b\\n' >s; $HSH s" \
+    "a\nb" 0
+
+rm -rf "$TMP"
+exit $failed
@@ -0,0 +1,509 @@
+#include "main.h"
+
+#define DIR_CACHE_SIZE 8
+#define DENTS_BUF 262144
+
+/**
+ * struct dir_cache_s - listing of one directory, kept across lines
+ * @path: directory as the pattern named it ("" for the current one)
+ * @dev: device of the directory when it was read
+ * @ino: inode of the directory when it was read
+ * @mtime: modification time of the directory when it was read
+ * @racy: 1 if @mtime was not older than the read itself, so a change in
+ * the same clock tick could go unnoticed; such a listing is read again
+ * @names: entries, each a d_type byte followed by the NUL terminated name
+ * @len: bytes used in @names
+ * @used: LRU stamp
+ * @busy: number of walk() calls iterating over @names right now
+ */
+typedef struct dir_cache_s
+{
+	char *path;
+	dev_t dev;
+	ino_t ino;
+	struct timespec mtime;
+	int racy;
+	char *names;
+	size_t len;
+	unsigned long used;
+	int busy;
+} dir_cache_t;
+
+static dir_cache_t dirs[DIR_CACHE_SIZE];
+static unsigned long dir_counter;
+
+/**
+ * read_dir - lists a directory with getdents64 into a cache slot
+ * @d: slot; @d->names is reused and grown as needed
+ * @fd: open directory
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int read_dir(dir_cache_t *d, int fd)
+{
+	char *buf = arena_alloc(DENTS_BUF), *grown;
+	struct dirent64 *e;
+	size_t cap = d->names != NULL ? d->len : 0, nlen;
+	ssize_t n, off;
+
+	if (buf == NULL)
+		return (-1);
+	d->len = 0;
+	while ((n = getdents64(fd, buf, DENTS_BUF)) > 0)
+		for (off = 0; off < n; off += e->d_reclen)
+		{
+			e = (struct dirent64 *)(buf + off);
+			nlen = _strlen(e->d_name) + 1;
+			if (d->len + nlen + 1 > cap)
+			{
+				cap = (d->len + nlen + 1) * 2;
+				grown = realloc(d->names, cap);
+				if (grown == NULL)
+					return (-1);
+				d->names = grown;
+			}
+			d->names[d->len] = (char)e->d_type;
+			memcpy(d->names + d->len + 1, e->d_name, nlen);
+			d->len += nlen + 1;
+		}
+	return (n < 0 ? -1 : 0);
+}
+
+/**
+ * list_dir - gets the listing of a directory, from the cache when the
+ * directory has not changed since it was read
+ * @path: directory ("" for the current one)
+ *
+ * Description: one stat() decides: the listing is reused while the
+ * directory's device, inode and mtime are the ones seen when it was
+ * read (adding, removing or renaming an entry updates the mtime), so a
+ * script that globs the same large directory many times reads it once.
+ *
+ * Return: the slot, NULL if the directory can't be read
+ */
+static dir_cache_t *list_dir(const char *path)
+{
+	const char *name = *path ? path : ".";
+	dir_cache_t *d = NULL;
+	struct stat st;
+	int i, fd;
+
+	if (stat(name, &st) == -1 || !S_ISDIR(st.st_mode))
+		return (NULL);
+	for (i = 0; i < DIR_CACHE_SIZE; i++)
+		if (dirs[i].path != NULL && _strcmp(dirs[i].path, path) == 0)
+		{
+			d = &dirs[i];
+			break;
+		}
+		else if (!dirs[i].busy && (d == NULL || dirs[i].used < d->used))
+			d = &dirs[i];
+	if (d == NULL)
+		return (NULL);
+	d->used = ++dir_counter;
+	if (d->path != NULL && _strcmp(d->path, path) == 0 && (d->busy ||
+		(!d->racy && d->dev == st.st_dev && d->ino == st.st_ino &&
+		 d->mtime.tv_sec == st.st_mtim.tv_sec &&
+		 d->mtime.tv_nsec == st.st_mtim.tv_nsec)))
+		return (d);
+	free(d->path);
+	d->path = _strdup(path);
+	fd = open(name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (d->path == NULL || fd == -1 || read_dir(d, fd) == -1)
+	{
+		if (fd != -1)
+			close(fd);
+		free(d->path);
+		d->path = NULL;
+		return (NULL);
+	}
+	close(fd);
+	d->dev = st.st_dev;
+	d->ino = st.st_ino;
+	d->mtime = st.st_mtim;
+	d->racy = st.st_mtim.tv_sec >= time(NULL);
+	return (d);
+}
+
+/**
+ * compile_set - compiles a [...] bracket expression
+ * @p: text just after the '['
+ * @end: end of the component
+ * @op: receives the GLOB_SET op
+ *
+ * Return: pointer past the closing ']', NULL if there is none (the '['
+ * is then an ordinary character)
+ */
+static const char *compile_set(const char *p, const char *end, glob_op_t *op)
+{
+	unsigned char *set = arena_alloc(32), lo, hi;
+	int neg = 0, i, c;
+
+	if (set == NULL)
+		return (NULL);
+	memset(set, 0, 32);
+	if (p < end && (*p == '!' || *p == '^'))
+		neg = 1, p++;
+	for (i = 0; p < end && (*p != ']' || i == 0); i++)
+	{
+		if (*p == '\\' && p + 1 < end)
+			p++;
+		lo = hi = (unsigned char)*p++;
+		if (p + 1 < end && *p == '-' && p[1] != ']')
+		{
+			p += p[1] == '\\' && p + 2 < end ? 2 : 1;
+			hi = (unsigned char)*p++;
+		}
+		for (c = lo; c <= hi; c++)
+			set[c >> 3] |= 1 << (c & 7);
+	}
+	if (p >= end)
+		return (NULL);
+	if (neg)
+		for (i = 0; i < 32; i++)
+			set[i] = ~set[i];
+	set[0] &= ~1; /* never the NUL */
+	op->type = GLOB_SET;
+	op->set = set;
+	return (p + 1);
+}
+
+/**
+ * glob_compile - turns one pattern component into a list of ops
+ * @p: component, with \ escapes
+ * @end: end of the component
+ * @n: receives the number of ops
+ *
+ * Return: ops (in the arena), NULL if out of memory
+ */
+glob_op_t *glob_compile(const char *p, const char *end, int *n)
+{
+	glob_op_t *ops = arena_alloc(sizeof(glob_op_t) * (end - p + 1));
+	const char *next;
+
+	*n = 0;
+	while (ops != NULL && p < end)
+	{
+		ops[*n].set = NULL;
+		if (*p == '*')
+		{
+			if (*n == 0 || ops[*n - 1].type != GLOB_STAR) /* ** is * */
+				ops[(*n)++].type = GLOB_STAR;
+			p++;
+			continue;
+		}
+		if (*p == '?')
+			ops[*n].type = GLOB_ANY, p++;
+		else if (*p == '[' && (next = compile_set(p + 1, end, &ops[*n])) != NULL)
+			p = next;
+		else
+		{
+			if (*p == '\\' && p + 1 < end)
+				p++;
+			ops[*n].type = GLOB_CHAR;
+			ops[*n].c = (unsigned char)*p++;
+		}
+		(*n)++;
+	}
+	return (ops);
+}
+
+/**
+ * glob_keep - copies compiled ops out of the arena
+ * @ops: compiled pattern
+ * @n: number of ops
+ *
+ * Description: the ops and their bracket sets go in one malloc'd block,
+ * released with a single free().
+ *
+ * Return: the copy, NULL if out of memory
+ */
+glob_op_t *glob_keep(const glob_op_t *ops, int n)
+{
+	glob_op_t *copy = malloc(sizeof(glob_op_t) * n + 32 * n + 1);
+	unsigned char *sets = (unsigned char *)(copy + n);
+	int i;
+
+	if (copy == NULL)
+		return (NULL);
+	memcpy(copy, ops, sizeof(glob_op_t) * n);
+	for (i = 0; i < n; i++)
+		if (ops[i].set != NULL)
+		{
+			copy[i].set = memcpy(sets, ops[i].set, 32);
+			sets += 32;
+		}
+	return (copy);
+}
+
+/**
+ * op_match - tests one byte against a non-star op
+ * @op: op
+ * @c: byte
+ *
+ * Return: 1 on a match, 0 otherwise
+ */
+static int op_match(const glob_op_t *op, unsigned char c)
+{
+	if (op->type == GLOB_CHAR)
+		return (op->c == c);
+	if (op->type == GLOB_SET)
+		return ((op->set[c >> 3] >> (c & 7)) & 1);
+	return (1);
+}
+
+/**
+ * glob_match_n - matches a slice of bytes against a compiled pattern
+ * @ops: compiled pattern
+ * @n: number of ops
+ * @s: bytes
+ * @len: number of bytes
+ *
+ * Description: a star first matches nothing and gives back one more
+ * byte each time the rest fails; only the last star is ever retried,
+ * which keeps the match linear in practice.
+ *
+ * Return: 1 if the whole slice matches, 0 otherwise
+ */
+int glob_match_n(const glob_op_t *ops, int n, const char *s, size_t len)
+{
+	const unsigned char *p = (const unsigned char *)s, *star_s = NULL;
+	const unsigned char *end = p + len;
+	int i = 0, star_i = -1;
+
+	while (p < end)
+	{
+		if (i < n && ops[i].type == GLOB_STAR)
+		{
+			star_i = i++;
+			star_s = p;
+		}
+		else if (i < n && op_match(&ops[i], *p))
+			i++, p++;
+		else if (star_i >= 0)
+		{
+			i = star_i + 1;
+			p = ++star_s;
+		}
+		else
+			return (0);
+	}
+	while (i < n && ops[i].type == GLOB_STAR)
+		i++;
+	return (i == n);
+}
+
+/**
+ * glob_match - matches a name against a compiled component
+ * @ops: compiled component
+ * @n: number of ops
+ * @s: name
+ *
+ * Return: 1 if the whole name matches, 0 otherwise
+ */
+int glob_match(const glob_op_t *ops, int n, const char *s)
+{
+	return (glob_match_n(ops, n, s, _strlen(s)));
+}
+
+/**
+ * has_meta - tells whether a pattern component needs a directory search
+ * @p: component, with \ escapes
+ * @end: end of the component
+ *
+ * Return: 1 if it has an unescaped *, ? or [, 0 otherwise
+ */
+static int has_meta(const char *p, const char *end)
+{
+	for (; p < end; p++)
+		if (*p == '\\' && p + 1 < end)
+			p++;
+		else if (*p == '*' || *p == '?' || *p == '[')
+			return (1);
+	return (0);
+}
+
+/**
+ * is_dir_entry - tells whether a listed entry can be descended into
+ * @path: directory holding the entry, "" or ending in '/'
+ * @name: entry
+ * @type: d_type of the entry
+ *
+ * Return: 1 for a directory or a link to one, 0 otherwise
+ */
+static int is_dir_entry(const strbuf_t *path, const char *name,
+						unsigned char type)
+{
+	strbuf_t full = {NULL, 0, 0};
+
+	if (type == DT_DIR)
+		return (1);
+	if (type != DT_LNK && type != DT_UNKNOWN)
+		return (0);
+	if (sb_append(&full, path->data, path->len) == -1 ||
+		sb_append(&full, name, _strlen(name)) == -1)
+		return (0);
+	return (is_directory(full.data));
+}
+
+static int walk(strbuf_t *path, const char *pat, strbuf_t *found);
+
+/**
+ * walk_globstar - expands a "**" component: any number of directories
+ * @path: directory reached so far, "" or ending in '/'; restored on return
+ * @rest: pattern after the "**" and its slash, NULL when "**" was last
+ * @found: matches, each NUL terminated
+ *
+ * Description: a last "**" matches every path below @path, as "**" then
+ * "*" would, and one followed by a lone slash every directory. When one
+ * component follows, globstar_walk() matches it
+ * while it walks; with more, the directories it lists are expanded one
+ * by one.
+ *
+ * Return: number of matches added, -1 if out of memory
+ */
+static int walk_globstar(strbuf_t *path, const char *rest, strbuf_t *found)
+{
+	strbuf_t dirs = {NULL, 0, 0};
+	const char *slash = rest != NULL ? _strchr(rest, '/') : NULL, *dir;
+	char *saved = arena_strdup(path->data, path->len);
+	glob_op_t *ops;
+	int nops, n, i, count, sub;
+
+	if (saved == NULL)
+		return (-1);
+	if (rest != NULL && *rest == '\0')
+		return (globstar_walk(saved, NULL, 0, found));
+	if (rest == NULL)
+		rest = "*";
+	if (slash == NULL)
+	{
+		ops = glob_compile(rest, rest + _strlen(rest), &nops);
+		return (ops == NULL ? -1 : globstar_walk(saved, ops, nops, found));
+	}
+	n = globstar_walk(saved, NULL, 0, &dirs);
+	count = n == -1 ? -1 : walk(path, rest, found); /* no directory at all */
+	for (i = 0, dir = dirs.data; count != -1 && i < n;
+		 i++, dir += _strlen(dir) + 1)
+	{
+		path->len = 0;
+		if (sb_append(path, dir, _strlen(dir)) == -1)
+			return (-1);
+		sub = walk(path, rest, found);
+		count = sub == -1 ? -1 : count + sub;
+	}
+	path->len = 0;
+	return (sb_append(path, saved, _strlen(saved)) == -1 ? -1 : count);
+}
+
+/**
+ * walk - expands the rest of a pattern below a directory
+ * @path: directory reached so far, "" or ending in '/'; restored on return
+ * @pat: rest of the pattern
+ * @found: matches, each NUL terminated
+ *
+ * Return: number of matches added, -1 if out of memory
+ */
+static int walk(strbuf_t *path, const char *pat, strbuf_t *found)
+{
+	const char *end = _strchr(pat, '/'), *name, *p;
+	size_t saved = path->len;
+	glob_op_t *ops;
+	dir_cache_t *d;
+	int nops, count = 0, sub;
+	struct stat st;
+
+	end = end != NULL ? end : pat + _strlen(pat);
+	if (end - pat == 2 && pat[0] == '*' && pat[1] == '*')
+		return (walk_globstar(path, *end == '/' ? end + 1 : NULL, found));
+	if (!has_meta(pat, end))
+	{
+		for (p = pat; p < end; p++) /* literal component: drop escapes */
+			if (sb_putc(path, *p == '\\' && p + 1 < end ? *++p : *p) == -1)
+				return (-1);
+		if (*end == '/')
+			count = sb_putc(path, '/') == -1 ? -1 : walk(path, end + 1, found);
+		else if (lstat(path->data, &st) == 0)
+			count = sb_append(found, path->data, path->len + 1) == -1 ? -1 : 1;
+		path->len = saved;
+		path->data[saved] = '\0';
+		return (count);
+	}
+	ops = glob_compile(pat, end, &nops);
+	d = list_dir(path->data);
+	if (ops == NULL || d == NULL)
+		return (ops == NULL ? -1 : 0);
+	d->busy++; /* a deeper walk() must not evict or reread it */
+	for (name = d->names; count != -1 && name < d->names + d->len;
+		 name += _strlen(name) + 1)
+	{
+		name++; /* d_type byte */
+		if ((*name == '.' && *pat != '.') || !glob_match(ops, nops, name) ||
+			(name[0] == '.' && (name[1] == '\0' ||
+								(name[1] == '.' && name[2] == '\0'))))
+			continue;
+		if (*end == '/' && !is_dir_entry(path, name, (unsigned char)name[-1]))
+			continue;
+		if (sb_append(path, name, _strlen(name)) == -1)
+		{
+			count = -1;
+			break;
+		}
+		if (*end == '/')
+			sub = sb_putc(path, '/') == -1 ? -1 : walk(path, end + 1, found);
+		else
+			sub = sb_append(found, path->data, path->len + 1) == -1 ? -1 : 1;
+		count = sub == -1 ? -1 : count + sub;
+		path->len = saved;
+		path->data[saved] = '\0';
+	}
+	d->busy--;
+	return (count);
+}
+
+/**
+ * cmp_names - qsort comparison for match pointers
+ * @a: first pointer
+ * @b: second pointer
+ *
+ * Return: strcmp order
+ */
+static int cmp_names(const void *a, const void *b)
+{
+	return (strcmp(*(char *const *)a, *(char *const *)b));
+}
+
+/**
+ * glob_expand - expands a pathname pattern
+ * @pattern: pattern with *, ?, [...]; a \ makes the next byte literal
+ * @out: buffer the matches are appended to, each NUL terminated
+ *
+ * Description: each component is compiled once and matched against
+ * the cached listing of its directory; names starting with '.' only
+ * match a component that starts with '.', and "." and ".." never do.
+ *
+ * Return: number of matches (sorted), 0 if none, -1 if out of memory
+ */
+int glob_expand(const char *pattern, strbuf_t *out)
+{
+	strbuf_t path = {NULL, 0, 0}, found = {NULL, 0, 0};
+	char **names;
+	char *p;
+	int n, i;
+
+	if (sb_append(&path, "/", *pattern == '/') == -1)
+		return (-1);
+	n = walk(&path, pattern + (*pattern == '/'), &found);
+	if (n <= 0)
+		return (n);
+	names = arena_alloc(sizeof(char *) * n);
+	if (names == NULL)
+		return (-1);
+	for (p = found.data, i = 0; i < n; p += _strlen(p) + 1)
+		names[i++] = p;
+	qsort(names, n, sizeof(char *), cmp_names);
+	for (i = 0; i < n; i++)
+		if (sb_append(out, names[i], _strlen(names[i]) + 1) == -1)
+			return (-1);
+	return (n);
+}
@@ -0,0 +1,445 @@
+#include "main.h"
+
+#define GS_MAX_THREADS 64
+#define GS_DENTS_BUF 65536
+
+/**
+ * struct gs_deque_s - directories waiting to be read by one worker
+ * @lock: guards the fields below
+ * @items: directory paths relative to the root, each ending in '/'
+ * (the root itself is "")
+ * @head: next item a thief takes (the oldest, nearest the root)
+ * @tail: one past the item the owner takes next (the newest)
+ * @cap: capacity of @items
+ */
+typedef struct gs_deque_s
+{
+	pthread_mutex_t lock;
+	char **items;
+	size_t head;
+	size_t tail;
+	size_t cap;
+} gs_deque_t;
+
+struct gs_pool_s;
+
+/**
+ * struct gs_worker_s - one thread of the walk
+ * @tasks: its own work
+ * @out: paths it found, relative to the root, each NUL terminated
+ * @len: bytes used in @out
+ * @cap: capacity of @out
+ * @count: number of paths in @out
+ * @buf: getdents64 buffer
+ * @seed: state for picking a victim to steal from
+ * @pool: the walk it belongs to
+ * @thread: its thread (unused for worker 0, the calling thread)
+ */
+typedef struct gs_worker_s
+{
+	gs_deque_t tasks;
+	char *out;
+	size_t len;
+	size_t cap;
+	int count;
+	char *buf;
+	unsigned int seed;
+	struct gs_pool_s *pool;
+	pthread_t thread;
+} gs_worker_t;
+
+/**
+ * struct gs_pool_s - state shared by the workers of one walk
+ * @root_fd: directory the walk starts from
+ * @ops: compiled last component, NULL to collect directories instead
+ * @nops: number of @ops
+ * @dot: 1 if @ops matches names starting with '.'
+ * @workers: the workers
+ * @n: number of workers taking part
+ * @pending: directories pushed but not finished yet; 0 ends the walk
+ * @queued: directories pushed but not taken yet
+ * @sleeping: workers waiting on @wake
+ * @idle: guards the waits on @wake
+ * @wake: signalled when a directory is pushed or the walk ends
+ * @failed: set when an allocation failed
+ */
+typedef struct gs_pool_s
+{
+	int root_fd;
+	const glob_op_t *ops;
+	int nops;
+	int dot;
+	gs_worker_t *workers;
+	int n;
+	long pending;
+	long queued;
+	int sleeping;
+	pthread_mutex_t idle;
+	pthread_cond_t wake;
+	int failed;
+} gs_pool_t;
+
+/**
+ * push - gives a directory to a worker
+ * @w: worker (the one that found it)
+ * @rel: path relative to the root, ending in '/'; ownership passes
+ *
+ * Return: 0 on success, -1 if out of memory (@rel is freed)
+ */
+static int push(gs_worker_t *w, char *rel)
+{
+	gs_deque_t *q = &w->tasks;
+	char **grown;
+
+	pthread_mutex_lock(&q->lock);
+	if (q->head == q->tail)
+		q->head = q->tail = 0;
+	if (q->tail == q->cap)
+	{
+		grown = realloc(q->items, sizeof(char *) * (q->cap * 2 + 64));
+		if (grown == NULL)
+		{
+			pthread_mutex_unlock(&q->lock);
+			free(rel);
+			return (-1);
+		}
+		q->items = grown;
+		q->cap = q->cap * 2 + 64;
+	}
+	q->items[q->tail++] = rel;
+	__atomic_add_fetch(&w->pool->pending, 1, __ATOMIC_SEQ_CST);
+	__atomic_add_fetch(&w->pool->queued, 1, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&q->lock);
+	if (__atomic_load_n(&w->pool->sleeping, __ATOMIC_SEQ_CST) > 0)
+	{
+		pthread_mutex_lock(&w->pool->idle);
+		pthread_cond_signal(&w->pool->wake);
+		pthread_mutex_unlock(&w->pool->idle);
+	}
+	return (0);
+}
+
+/**
+ * take - gets the next directory to read
+ * @w: worker
+ *
+ * Description: the worker takes its newest directory, which keeps its
+ * walk depth-first and its deque short; when it has none it steals the
+ * oldest one of another worker, which is likely the root of a large
+ * subtree.
+ *
+ * Return: the path (to be freed), NULL if there was nothing to take
+ */
+static char *take(gs_worker_t *w)
+{
+	gs_pool_t *pool = w->pool;
+	gs_deque_t *q = &w->tasks;
+	char *rel = NULL;
+	int i, v;
+
+	pthread_mutex_lock(&q->lock);
+	if (q->head < q->tail)
+		rel = q->items[--q->tail];
+	pthread_mutex_unlock(&q->lock);
+	w->seed = w->seed * 1103515245 + 12345;
+	for (i = 0, v = (w->seed >> 16) % pool->n; rel == NULL && i < pool->n;
+		 i++, v = (v + 1) % pool->n)
+	{
+		q = &pool->workers[v].tasks;
+		pthread_mutex_lock(&q->lock);
+		if (q->head < q->tail)
+			rel = q->items[q->head++];
+		pthread_mutex_unlock(&q->lock);
+	}
+	if (rel != NULL)
+		__atomic_sub_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+	return (rel);
+}
+
+/**
+ * add_result - records a path found by a worker
+ * @w: worker
+ * @rel: directory, relative to the root
+ * @name: entry in it ("" for the directory itself)
+ *
+ * Return: 0 on success, -1 if out of memory
+ */
+static int add_result(gs_worker_t *w, const char *rel, const char *name)
+{
+	size_t rlen = _strlen(rel), nlen = _strlen(name), need;
+	char *grown;
+
+	need = w->len + rlen + nlen + 1;
+	if (need > w->cap)
+	{
+		grown = realloc(w->out, need * 2);
+		if (grown == NULL)
+			return (-1);
+		w->out = grown;
+		w->cap = need * 2;
+	}
+	memcpy(w->out + w->len, rel, rlen);
+	memcpy(w->out + w->len + rlen, name, nlen);
+	w->out[need - 1] = '\0';
+	w->len = need;
+	w->count++;
+	return (0);
+}
+
+/**
+ * is_dir_at - tells whether an entry is a directory, not following
+ * symlinks
+ * @fd: directory holding the entry
+ * @name: entry
+ * @type: its d_type
+ *
+ * Return: 1 if it is a directory, 0 otherwise (a symlink to one too)
+ */
+static int is_dir_at(int fd, const char *name, unsigned char type)
+{
+	struct stat st;
+
+	if (type != DT_UNKNOWN)
+		return (type == DT_DIR);
+	return (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0 &&
+			S_ISDIR(st.st_mode));
+}
+
+/**
+ * read_one - reads one directory: records the matching entries and
+ * queues the subdirectories
+ * @w: worker
+ * @rel: directory, relative to the root
+ *
+ * Description: directories starting with '.' are not entered, and
+ * neither are symlinks to directories (as in bash 4.3 and later), so
+ * every directory is read once and the walk cannot loop.
+ *
+ * Return: 0 on success, -1 if out of memory
+ */
+static int read_one(gs_worker_t *w, const char *rel)
+{
+	gs_pool_t *pool = w->pool;
+	struct dirent64 *e;
+	ssize_t n, off;
+	size_t rlen = _strlen(rel), nlen;
+	char *child;
+	int fd, rtn = 0;
+
+	fd = openat(pool->root_fd, *rel ? rel : ".",
+				O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd == -1)
+		return (0);
+	if (pool->ops == NULL && *rel)
+		rtn = add_result(w, rel, "");
+	while (rtn == 0 && (n = getdents64(fd, w->buf, GS_DENTS_BUF)) > 0)
+		for (off = 0; rtn == 0 && off < n; off += e->d_reclen)
+		{
+			e = (struct dirent64 *)(w->buf + off);
+			if (e->d_name[0] == '.' && (e->d_name[1] == '\0' ||
+				(e->d_name[1] == '.' && e->d_name[2] == '\0')))
+				continue;
+			if (pool->ops != NULL && (e->d_name[0] != '.' || pool->dot) &&
+				glob_match(pool->ops, pool->nops, e->d_name))
+				rtn = add_result(w, rel, e->d_name);
+			if (rtn == -1 || e->d_name[0] == '.' ||
+				!is_dir_at(fd, e->d_name, e->d_type))
+				continue;
+			nlen = _strlen(e->d_name);
+			child = malloc(rlen + nlen + 2);
+			if (child == NULL)
+			{
+				rtn = -1;
+				break;
+			}
+			memcpy(child, rel, rlen);
+			memcpy(child + rlen, e->d_name, nlen);
+			child[rlen + nlen] = '/';
+			child[rlen + nlen + 1] = '\0';
+			rtn = push(w, child);
+		}
+	close(fd);
+	return (rtn);
+}
+
+/**
+ * wait_for_work - blocks a worker that found nothing to take
+ * @pool: the walk
+ *
+ * Description: push() signals @pool->wake when it sees a sleeper, and
+ * the worker that finishes the last directory broadcasts it; since a
+ * pusher bumps queued before it reads sleeping and a sleeper bumps
+ * sleeping before it reads queued, one of them always sees the other.
+ *
+ * Return: 1 if there may be work, 0 once the walk is over
+ */
+static int wait_for_work(gs_pool_t *pool)
+{
+	int more;
+
+	pthread_mutex_lock(&pool->idle);
+	__atomic_add_fetch(&pool->sleeping, 1, __ATOMIC_SEQ_CST);
+	while (__atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) == 0 &&
+		   __atomic_load_n(&pool->pending, __ATOMIC_SEQ_CST) != 0)
+		pthread_cond_wait(&pool->wake, &pool->idle);
+	__atomic_sub_fetch(&pool->sleeping, 1, __ATOMIC_SEQ_CST);
+	more = __atomic_load_n(&pool->pending, __ATOMIC_SEQ_CST) != 0;
+	pthread_mutex_unlock(&pool->idle);
+	return (more);
+}
+
+/**
+ * finish_one - reads a directory a worker took, ending the walk if it
+ * was the last one
+ * @w: worker
+ * @rel: what take() returned; freed
+ */
+static void finish_one(gs_worker_t *w, char *rel)
+{
+	gs_pool_t *pool = w->pool;
+
+	if (read_one(w, rel) == -1)
+		__atomic_store_n(&pool->failed, 1, __ATOMIC_RELAXED);
+	free(rel);
+	if (__atomic_sub_fetch(&pool->pending, 1, __ATOMIC_SEQ_CST) == 0)
+	{
+		pthread_mutex_lock(&pool->idle);
+		pthread_cond_broadcast(&pool->wake);
+		pthread_mutex_unlock(&pool->idle);
+	}
+}
+
+/**
+ * work - runs one worker until every directory has been read
+ * @arg: the worker
+ *
+ * Return: NULL
+ */
+static void *work(void *arg)
+{
+	gs_worker_t *w = arg;
+	char *rel;
+
+	while (1)
+	{
+		rel = take(w);
+		if (rel != NULL)
+			finish_one(w, rel);
+		else if (!wait_for_work(w->pool))
+			break;
+	}
+	return (NULL);
+}
+
+/**
+ * thread_count - number of workers for a walk
+ *
+ * Description: HSH_GLOB_THREADS, if set, else the number of online CPUs,
+ * within 1 and GS_MAX_THREADS.
+ *
+ * Return: the number
+ */
+static int thread_count(void)
+{
+	char *env = _getenv("HSH_GLOB_THREADS");
+	long n = env != NULL && isNumber(env) ? _atoi_safe(env)
+										   : sysconf(_SC_NPROCESSORS_ONLN);
+
+	return (n < 1 ? 1 : n > GS_MAX_THREADS ? GS_MAX_THREADS : (int)n);
+}
+
+/**
+ * globstar_walk - expands "**" below a directory with a pool of threads
+ * @root: directory to start from, "" or ending in '/'
+ * @ops: compiled component that follows "**", or NULL to list the
+ * directories themselves
+ * @nops: number of @ops
+ * @found: buffer the paths are appended to (@root included), each NUL
+ * terminated, in no particular order
+ *
+ * Description: each worker reads directories with openat() and
+ * getdents64() from its own deque and steals from the others when it
+ * runs dry; matches go to per-worker buffers that are merged once all
+ * threads are done, so nothing is shared on the hot path but the
+ * deques. Symlinks to directories are not entered, so each directory
+ * is read once. The calling thread reads @root first, and only as many
+ * threads are started as that left directories queued, so a small tree
+ * costs no thread at all; idle workers sleep on a condition variable
+ * rather than spin. With @ops, entries of @root itself are matched too ("**" can match
+ * no directory at all); without, @root is not listed.
+ *
+ * Return: number of paths, -1 if out of memory
+ */
+int globstar_walk(const char *root, const glob_op_t *ops, int nops,
+				  strbuf_t *found)
+{
+	gs_pool_t pool;
+	gs_worker_t *w;
+	char *start = _strdup("");
+	char *p;
+	int i, k, count = 0, rtn, nalloc;
+
+	memset(&pool, 0, sizeof(pool));
+	pool.ops = ops;
+	pool.nops = nops;
+	pool.dot = nops > 0 && ops[0].type == GLOB_CHAR && ops[0].c == '.';
+	pool.n = nalloc = thread_count();
+	pool.root_fd = open(*root ? root : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	pool.workers = calloc(pool.n, sizeof(gs_worker_t));
+	if (pool.root_fd == -1 || pool.workers == NULL || start == NULL)
+	{
+		free(pool.workers);
+		free(start);
+		if (pool.root_fd != -1)
+			close(pool.root_fd);
+		return (pool.root_fd == -1 ? 0 : -1);
+	}
+	pthread_mutex_init(&pool.idle, NULL);
+	pthread_cond_init(&pool.wake, NULL);
+	for (i = 0; i < nalloc; i++)
+	{
+		w = &pool.workers[i];
+		pthread_mutex_init(&w->tasks.lock, NULL);
+		w->pool = &pool;
+		w->seed = i + 1;
+		w->buf = malloc(GS_DENTS_BUF);
+		pool.failed |= w->buf == NULL;
+	}
+	if (pool.failed)
+		free(start);
+	else if (push(&pool.workers[0], start) == -1)
+		pool.failed = 1;
+	else
+	{
+		finish_one(&pool.workers[0], take(&pool.workers[0])); /* @root */
+		if (pool.n > pool.queued + 1)
+			pool.n = pool.queued + 1;
+		for (i = 1; i < pool.n; i++)
+			if (pthread_create(&pool.workers[i].thread, NULL, work,
+							   &pool.workers[i]) != 0)
+				break;
+		work(&pool.workers[0]);
+		for (k = 1; k < i; k++)
+			pthread_join(pool.workers[k].thread, NULL);
+	}
+	rtn = pool.failed ? -1 : 0;
+	for (i = 0; i < nalloc; i++)
+	{
+		w = &pool.workers[i];
+		for (k = 0, p = w->out; rtn == 0 && k < w->count;
+			 k++, p += _strlen(p) + 1)
+			if (sb_append(found, root, _strlen(root)) == -1 ||
+				sb_append(found, p, _strlen(p) + 1) == -1)
+				rtn = -1;
+		count += w->count;
+		free(w->out);
+		free(w->buf);
+		free(w->tasks.items);
+		pthread_mutex_destroy(&w->tasks.lock);
+	}
+	free(pool.workers);
+	pthread_cond_destroy(&pool.wake);
+	pthread_mutex_destroy(&pool.idle);
+	close(pool.root_fd);
+	return (rtn == -1 ? -1 : count);
+}
@@ -0,0 +1,52 @@
+#ifndef HSH_PLUGIN_H
+#define HSH_PLUGIN_H
+
+#include <stddef.h>
+
+/*
+ * The interface between hsh and builtins loaded with "enable -f".
+ *
+ * A plugin is a shared object defining
+ *
+ *	int hsh_plugin_init(int abi);
+ *
+ * which the shell calls once, right after loading it, with
+ * HSH_PLUGIN_ABI. It returns -1 if it was built for another ABI and
+ * otherwise registers its builtins with hsh_builtin_register() and
+ * returns 0. It may also define
+ *
+ *	void hsh_plugin_fini(void);
+ *
+ * which is called before the shared object is unloaded, once
+ * "enable -d" has removed the last of its builtins.
+ *
+ * Only what is declared here is part of the interface; new functions
+ * may be added, but none of these change without HSH_PLUGIN_ABI
+ * changing too. Build a plugin with "gcc -shared -fPIC".
+ */
+#define HSH_PLUGIN_ABI 1
+
+/* hsh_builtin_register() flags */
+#define HSH_BI_PURE 0x1 /* only writes to fd 1, changes nothing */
+
+typedef struct hsh_call_s hsh_call_t; /* one run of a builtin */
+
+/* a builtin: returns its exit status */
+typedef int (*hsh_builtin_fn)(hsh_call_t *call);
+
+int hsh_builtin_register(const char *name, hsh_builtin_fn fn, int flags);
+
+/* arguments: hsh_argv(call)[0] is the builtin's name */
+int hsh_argc(const hsh_call_t *call);
+char *const *hsh_argv(const hsh_call_t *call);
+
+/* fds: the descriptor that is the command's fd n once redirected */
+int hsh_fd(const hsh_call_t *call, int n);
+long hsh_write(hsh_call_t *call, int n, const void *buf, size_t len);
+
+/* variables: values are valid until the variable next changes */
+const char *hsh_getvar(const char *name);
+int hsh_setvar(const char *name, const char *value);
+int hsh_unsetvar(const char *name);
+
+#endif /* HSH_PLUGIN_H */
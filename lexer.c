@@ -0,0 +1,304 @@
+#include "main.h"
+
+/**
+ * skip_backquote - finds the end of a `...` substitution
+ * @p: text just after the opening backquote
+ *
+ * Return: pointer to the closing backquote, NULL if unterminated
+ */
+static const char *skip_backquote(const char *p)
+{
+	for (; *p && *p != '`'; p++)
+		if (*p == '\\' && p[1])
+			p++;
+	return (*p ? p : NULL);
+}
+
+/**
+ * skip_dquote - finds the end of a "..." string
+ * @p: text just after the opening quote
+ *
+ * Return: pointer to the closing quote, NULL if unterminated
+ */
+static const char *skip_dquote(const char *p)
+{
+	for (; *p && *p != '"'; p++)
+	{
+		if (*p == '\\' && p[1])
+			p++;
+		else if (*p == '$' && (p[1] == '(' || p[1] == '{'))
+		{
+			p = p[1] == '(' ? find_closing_paren((char *)p + 2)
+							: find_closing_brace(p + 2);
+			if (p == NULL)
+				return (NULL);
+		}
+		else if (*p == '`')
+		{
+			p = skip_backquote(p + 1);
+			if (p == NULL)
+				return (NULL);
+		}
+	}
+	return (*p ? p : NULL);
+}
+
+/**
+ * find_closing_brace - finds the '}' that ends a ${...}
+ * @s: text just after the "${"
+ *
+ * Description: quotes, backslashes and nested $(...), `...` and ${...}
+ * are skipped, so ${v:-"}"} and ${v:-${w}} end where they should.
+ *
+ * Return: pointer to the closing brace, NULL if unterminated
+ */
+const char *find_closing_brace(const char *s)
+{
+	int depth = 1;
+
+	for (; *s; s++)
+	{
+		if (*s == '\\' && s[1])
+			s++;
+		else if (*s == '\'')
+			s = _strchr(s + 1, '\'');
+		else if (*s == '"')
+			s = skip_dquote(s + 1);
+		else if (*s == '`')
+			s = skip_backquote(s + 1);
+		else if (*s == '$' && s[1] == '(')
+			s = find_closing_paren((char *)s + 2);
+		else if (*s == '$' && s[1] == '{')
+			depth++, s++;
+		else if (*s == '}' && --depth == 0)
+			return (s);
+		if (s == NULL)
+			return (NULL);
+	}
+	return (NULL);
+}
+
+/**
+ * array_open - tells whether a '(' opens the list of a NAME=(...)
+ * array assignment
+ * @s: first byte of the word
+ * @p: the '('
+ *
+ * Return: 1 if the word so far is NAME=, 0 otherwise
+ */
+static int array_open(const char *s, const char *p)
+{
+	const char *q = s;
+
+	if (!(isalpha((unsigned char)*q) || *q == '_'))
+		return (0);
+	while (isalnum((unsigned char)*q) || *q == '_')
+		q++;
+	return (*q == '=' && q + 1 == p);
+}
+
+/**
+ * scan_word - finds the end of a word
+ * @s: first byte of the word
+ * @what: set to the construct left open when NULL is returned
+ *
+ * Description: quotes, backslashes, $(...), ${...}, `...`, a leading
+ * <(...) or >(...) and the (...) of NAME=(...) are part of the word,
+ * operators inside them included.
+ *
+ * Return: pointer just past the word, NULL if something is unterminated
+ */
+static const char *scan_word(const char *s, const char **what)
+{
+	const char *p = s, *q;
+
+	while (1)
+	{
+		p += scan_plain(p);
+		q = NULL;
+		if (*p == '\'')
+			q = _strchr(p + 1, '\''), *what = "quoted string";
+		else if (*p == '"')
+			q = skip_dquote(p + 1), *what = "quoted string";
+		else if (*p == '`')
+			q = skip_backquote(p + 1), *what = "`";
+		else if (*p == '$' && (p[1] == '(' || p[1] == '{'))
+		{
+			*what = p[1] == '(' ? "$(" : "${";
+			q = p[1] == '(' ? find_closing_paren((char *)p + 2)
+							: find_closing_brace(p + 2);
+		}
+		else if ((*p == '<' || *p == '>') && p[1] == '(' && p == s)
+			q = find_closing_paren((char *)p + 2), *what = "(";
+		else if (*p == '(' && array_open(s, p))
+			q = find_closing_paren((char *)p + 1), *what = "(";
+		else if (*p == '\\' || *p == '$' || *p == '#')
+		{
+			p += (*p == '\\' && p[1]) ? 2 : 1;
+			continue;
+		}
+		else
+			return (p);
+		if (q == NULL)
+			return (NULL);
+		p = q + 1;
+	}
+}
+
+/**
+ * lex_redir - reads a redirection operator, with its optional fd
+ * @s: text that may start with "[n]>", "[n]>>", "[n]>|", "[n]<", "[n]<<",
+ * "[n]<>", "[n]>&", "[n]<&", "&>" or "&>>"
+ * @t: receives the fd and operator
+ *
+ * Return: length of the operator text, 0 if @s is not a redirection
+ */
+static int lex_redir(const char *s, token_t *t)
+{
+	const char *p = s;
+	int fd = -1;
+
+	if (*p >= '0' && *p <= '9')
+	{
+		for (fd = 0; *p >= '0' && *p <= '9'; p++)
+			fd = fd * 10 + (*p - '0');
+		if (*p != '<' && *p != '>')
+			return (0);
+	}
+	if (p[0] == '&' && p[1] == '>' && fd == -1)
+	{
+		t->op = p[2] == '>' ? REDIR_BOTH_APPEND : REDIR_BOTH;
+		p += p[2] == '>' ? 3 : 2;
+		fd = STDOUT_FILENO;
+	}
+	else if (p[0] == '>')
+	{
+		t->op = p[1] == '>' ? REDIR_APPEND : p[1] == '&' ? REDIR_DUP : REDIR_OUT;
+		p += (t->op == REDIR_OUT && p[1] != '|') ? 1 : 2;
+		fd = fd == -1 ? STDOUT_FILENO : fd;
+	}
+	else if (p[0] == '<')
+	{
+		t->op = p[1] == '<' ? REDIR_HEREDOC : p[1] == '&' ? REDIR_DUP
+					: p[1] == '>' ? REDIR_RDWR : REDIR_IN;
+		p += t->op == REDIR_IN ? 1 : 2;
+		fd = fd == -1 ? STDIN_FILENO : fd;
+	}
+	else
+		return (0);
+	t->fd = fd;
+	return (p - s);
+}
+
+/**
+ * lex_operator - reads a control operator
+ * @s: text at the operator
+ * @t: receives the token type
+ *
+ * Return: length of the operator, 0 if @s is not one
+ */
+static int lex_operator(const char *s, token_t *t)
+{
+	if (s[0] == ';' && s[1] == ';') /* case terminator: always unexpected */
+	{
+		t->type = TOK_SEMI;
+		return (2);
+	}
+	if (s[0] == '\n' || s[0] == ';' || s[0] == '(' || s[0] == ')')
+	{
+		t->type = s[0] == '\n' ? TOK_NEWLINE : s[0] == ';' ? TOK_SEMI
+				: s[0] == '(' ? TOK_LPAREN : TOK_RPAREN;
+		return (1);
+	}
+	if (s[0] == '|' || (s[0] == '&' && s[1] != '>'))
+	{
+		if (s[1] == s[0])
+		{
+			t->type = s[0] == '|' ? TOK_OR_IF : TOK_AND_IF;
+			return (2);
+		}
+		t->type = s[0] == '|' ? TOK_PIPE : TOK_AMP;
+		return (1);
+	}
+	return (0);
+}
+
+/**
+ * lex_line - splits a command line into tokens in a single pass
+ * @line: command line; tokens point into it, so it must outlive them
+ * @tokens: receives a malloc'd array ending with a TOK_END token
+ *
+ * Description: words are (pointer, length) slices of @line with their
+ * quotes and escapes still in place; nothing is copied.
+ *
+ * Return: number of tokens before TOK_END, -1 on error (message printed)
+ */
+int lex_line(const char *line, token_t **tokens)
+{
+	const char *p = line, *end, *what = "";
+	int n = 0, cap = 16, len;
+	token_t *toks = malloc(sizeof(token_t) * cap), t, *tmp;
+
+	while (toks != NULL)
+	{
+		while (*p == ' ' || *p == '\t' || *p == '\r')
+			p++;
+		if (*p == '#') /* comment: the rest of the line is ignored */
+			p += _strcspn(p, "\n");
+		t.start = p;
+		t.body = NULL;
+		t.fd = -1;
+		t.op = REDIR_IN;
+		if (*p == '\0')
+		{
+			t.type = TOK_END;
+			t.len = 0;
+			toks[n] = t;
+			*tokens = toks;
+			return (n);
+		}
+		len = (*p == '<' || *p == '>') && p[1] == '(' ? 0 : lex_redir(p, &t);
+		if (len > 0)
+			t.type = TOK_REDIR;
+		else
+			len = lex_operator(p, &t);
+		if (len == 0)
+		{
+			end = scan_word(p, &what);
+			if (end == NULL)
+			{
+				fprintf(stderr, "%s: 1: Syntax error: Unterminated %s\n",
+						shell.name, what);
+				free(toks);
+				return (-1);
+			}
+			t.type = TOK_WORD;
+			len = end - p;
+		}
+		t.len = len;
+		p += len;
+		toks[n++] = t;
+		if (n == cap) /* keeps a slot for TOK_END */
+		{
+			tmp = realloc(toks, sizeof(token_t) * (cap *= 2));
+			if (tmp == NULL)
+				free(toks);
+			toks = tmp;
+		}
+	}
+	perror("malloc");
+	return (-1);
+}
+
+/**
+ * free_tokens - frees a token array
+ * @tokens: array from lex_line()
+ * @n: number of tokens
+ *
+ * Description: here-document bodies live in the line arena.
+ */
+void free_tokens(token_t *tokens, int n)
+{
+	(void)n;
+	free(tokens);
+}
@@ -22,8 +22,9 @@ run_test() {
     echo "Actual Output: '$output'"
     echo "Actual Exit Code: $actual_exit_code"
 
-    # Check if the output matches (using grep -q for partial matching)
-    if echo "$output" | grep -q "$expected_output"; then
+    # Check if the output matches (partial matching; \n in the expected
+    # output is a newline)
+    if [[ "$output" == *"$(printf '%b' "$expected_output")"* ]]; then
         output_check="PASSED"
     else
         output_check="FAILED"
@@ -73,13 +74,13 @@ run_test 11 "true && echo Part 1 ; echo Part 2 || echo Part 3" "Part 1\nPart 2"
 run_test 12 "nonexistent_command && echo This should NOT print || echo Command not found" "Command not found" 0  #Corrected expected output and exit
 run_test 13 "nonexistent_command ; echo This SHOULD print" "This SHOULD print" 0  #Corrected expected output and exit
 
-# Empty commands (should not crash, exit code should be 0 for empty command)
-run_test 14 "; ;" "" 0
-run_test 15 "&&" "" 1 #error code
-run_test 16 "||" "" 0  # or any non-zero code as appropriate for your shell
+# Operators with no command are syntax errors (status 2), as in sh
+run_test 14 "; ;" "Syntax error" 2
+run_test 15 "&&" "Syntax error" 2
+run_test 16 "||" "Syntax error" 2
 
 # Testing spaces around
-run_test 17 "ls     &&     echo Spaces around &&" "Spaces around &&" 0
+run_test 17 "ls     &&     echo Spaces around &&" "Syntax error" 2
 run_test 18 "ls -la ||       echo space around or" "" 0
 run_test 19 "echo first         ;           echo second" "first\nsecond" 0
 
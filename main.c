@@ -1,26 +1,67 @@
 #include "main.h"
 #include <signal.h>
 
+shell_t shell = {"hsh", 0, 0, NULL, 0, 0, NULL, 0, 0, 0, 0, -1};
+
 /**
  * main - starts the program and the loop
  * @argc: number of arguments
  * @argv: array of arguments
  *
- * Return: 0
+ * Description: "hsh -c string [name [args]]" runs string and
+ * "hsh file [args]" runs a script; both take the minimal startup path
+ * (no banner, no prompt, no PATH warm-up). Otherwise commands are read
+ * from stdin, interactively if it is a terminal.
+ *
+ * Return: exit status of the last command
  */
 int main(int argc, char *argv[])
 {
-	int isInteractive = isatty(STDIN_FILENO);
+	int isInteractive;
+	FILE *script;
+
+	shell.name = argv[0];
+	shell.pid = getpid();
+	if (argc > 1 && _strcmp(argv[1], "-c") == 0)
+	{
+		if (argc < 3)
+		{
+			fprintf(stderr, "%s: 0: -c requires an argument\n", argv[0]);
+			return (2);
+		}
+		if (argc > 3) /* $0 and positional parameters follow the string */
+			shell.name = argv[3];
+		shell.argc = argc > 4 ? argc - 4 : 0;
+		shell.argv = argv + (argc > 4 ? 4 : argc);
+		initialize_environ();
+		runString(argv[2]);
+		safeExit(shell.status);
+	}
+	if (argc > 1)
+	{
+		script = openScript(argv[1]);
+		if (script == NULL)
+		{
+			fprintf(stderr, "%s: 0: cannot open %s: No such file\n",
+					argv[0], argv[1]);
+			return (2);
+		}
+		shell.name = argv[1];
+		shell.argc = argc - 2;
+		shell.argv = argv + 2;
+		initialize_environ();
+		shellLoop(0, script); /* exits at end of file */
+	}
 
+	isInteractive = isatty(STDIN_FILENO);
 	/* ------------------- On entry - one time execution ------------------- */
-	(void)argc;
 	if (isInteractive)
 		printf("%sWelcome to the %sGates Of Shell%s. Type 'exit' to quit.\n\n",
 			   CLR_YELLOW_BOLD, CLR_RED_BOLD, CLR_YELLOW_BOLD);
 	/* --------------------------------------------------------------------- */
-	initialize_environ(); /* makes environ dynamically allocated */
+	initialize_environ(); /* loads environ into the env store */
 
-	shellLoop(isInteractive, argv); /* main shell loop */
+	shellLoop(isInteractive, stdin); /* main shell loop */
 
 	/* ------------------- On exit - one time execution ------------------- */
 	if (isInteractive)
@@ -31,87 +72,167 @@ int main(int argc, char *argv[])
 	/* -------------------------------------------------------------------- */
 }
 
+/**
+ * openScript - opens a script file on a high, close-on-exec fd
+ * @path: script file
+ *
+ * Description: keeps fds 3-9 free for "exec N>file" and "read -u N",
+ * and keeps the script away from the commands it runs.
+ *
+ * Return: stream to read the script from, NULL on error
+ */
+FILE *openScript(const char *path)
+{
+	int fd = open(path, O_RDONLY | O_CLOEXEC), high;
+
+	if (fd == -1)
+		return (NULL);
+	high = fcntl(fd, F_DUPFD_CLOEXEC, 10);
+	if (high != -1)
+	{
+		close(fd);
+		fd = high;
+	}
+	return (fdopen(fd, "r"));
+}
+
+/**
+ * run_builtin - runs a builtin in-process with its redirections applied
+ * @isAtty: result of isatty(), 1 if interactive, 0 otherwsie
+ * @cmd: parsed command
+ * @input: line the command was parsed from
+ *
+ * Description: every fd the plan touches is saved first and restored
+ * afterwards, so "echo hi >f 2>&1" needs no fork. VAR=value prefixes
+ * are set around the builtin the same way, in a scope of their own; on
+ * a line of their own they stay set, as shell variables.
+ *
+ * Return: what customCmd() returned, 1 if the redirections failed
+ */
+static int run_builtin(int isAtty, command_t *cmd, char *input)
+{
+	int saved_buf[16], *saved = saved_buf, rtn = 1;
+
+	if (cmd->nredirs > 8)
+	{
+		saved = arena_alloc(sizeof(int) * 2 * cmd->nredirs);
+		if (saved == NULL)
+			return (1);
+	}
+	fflush(stdout);
+	if (apply_redirections(cmd->redirs, cmd->nredirs, saved) == -1)
+		shell.status = 1;
+	else if (cmd->argv[0] == NULL) /* a lone "> file" only creates it */
+		shell.status = env_assign(cmd, 0) == -1 || cmd->assign_failed ? 1 :
+					   shell.status;
+	else if (cmd->nassigns > 0 && var_push_scope() == 0)
+	{
+		env_assign(cmd, 1);
+		rtn = customCmd(cmd->argv, isAtty, input);
+		var_pop_scope();
+	}
+	else
+		rtn = customCmd(cmd->argv, isAtty, input);
+	if (fflush(stdout) == EOF || ferror(stdout)) /* e.g. "echo x >&-" */
+	{
+		shell.status = 1;
+		clearerr(stdout);
+	}
+	restore_redirections(cmd->redirs, cmd->nredirs, saved);
+	return (rtn);
+}
+
+/**
+ * run_batches - runs an external command in ARG_MAX sized batches, all
+ * sharing one set of redirections
+ * @cmd: parsed command
+ * @full_path: resolved path of the command
+ *
+ * Description: the redirections are applied once around the batches,
+ * so "batch rm *.log >out" truncates out once, not per batch.
+ */
+static void run_batches(command_t *cmd, const char *full_path)
+{
+	int saved_buf[16], *saved = saved_buf;
+
+	if (cmd->nredirs > 8)
+	{
+		saved = arena_alloc(sizeof(int) * 2 * cmd->nredirs);
+		if (saved == NULL)
+		{
+			shell.status = 1;
+			return;
+		}
+	}
+	append_cache_prepare(cmd->redirs, cmd->nredirs);
+	fflush(stdout);
+	if (apply_redirections(cmd->redirs, cmd->nredirs, saved) == -1)
+		shell.status = 1;
+	else
+		shell.status = run_batched(full_path, cmd);
+	restore_redirections(cmd->redirs, cmd->nredirs, saved);
+}
+
 /**
  * executeIfValid - check if a command is a valid custom or built-in command;
- * run the command if it is valid; if child process fails,stop it
- * from re-entering loop
+ * run the command if it is valid and record its exit status in shell.status
  *
  * @isAtty: result of isatty(), 1 if interactive, 0 otherwsie
  * @argv: carrier of filename in [0]
- * @tokens: array of strings of user inputs delimited by spaces
+ * @cmd: parsed command: words and redirection plan
+ * @input: line the command was parsed from
  */
-void executeIfValid(int isAtty, char *const *argv, char **tokens, char *input)
+void executeIfValid(int isAtty, char *const *argv, command_t *cmd, char *input)
 {
 	int custom_cmd_rtn;
-	if (tokens[0] == NULL)
-	{
-		return; /*  Empty command - just return to the prompt */
-	}
+	char **tokens = cmd->argv, *full_path;
 
-	/* Handle built-in commands */
-	custom_cmd_rtn = customCmd(tokens, isAtty, input);
-	if (custom_cmd_rtn)
+	/* Handle built-in commands; they may set a non-zero status */
+	shell.status = tokens[0] == NULL && shell.subst_status != -1 ?
+				   shell.subst_status : 0;
+	if (tokens[0] != NULL && ifCmdExec(cmd)) /* changes the shell's own fds */
+		return;
+	if (tokens[0] == NULL || cmd->builtin)
 	{
+		custom_cmd_rtn = run_builtin(isAtty, cmd, input);
 		if (custom_cmd_rtn == 2) /* false directory */
 			fprintf(stderr, "%s: 1: cd: can't cd to %s\n", argv[0], tokens[1]);
 		else if (custom_cmd_rtn == 3) /* too many arguments */
 			fprintf(stderr, "%s: 1: cd: too many arguments\n", argv[0]);
+		if (custom_cmd_rtn == 2 || custom_cmd_rtn == 3)
+			shell.status = 2;
 
 		if ((custom_cmd_rtn == -1) && !isAtty)
-		{
-			resetAll(tokens, input, NULL);
 			safeExit(EXIT_SUCCESS);
-		}
 		return;
 	}
 
 	/* Not a built-in command, try executing as external command*/
-	/* *** CHECK FOR EMPTY COMMAND HERE *** */
-
-	char *full_path = findPath(tokens[0]);
+	full_path = cmd->path; /* resolved by the AST node, which owns it */
 	if (full_path == NULL)
 	{
 		fprintf(stderr, "%s: 1: %s: not found\n", argv[0], tokens[0]);
-		if (!isAtty)
-		{
-			resetAll(tokens, input, NULL);
-			safeExit(127); /* Standard not found error status */
-		}
+		shell.status = 127; /* Standard not found error status */
 		return; /* Return after handling "not found" */
 	}
 
-	int run_cmd_rtn = execute_command(full_path, tokens); /* pass tokens */
-	free(full_path);
-
-	if (run_cmd_rtn != 0)
+	if (batch_needed(cmd)) /* too long for one execve: run it in parts */
 	{
-		/* Handle errors from execute_command */
-		if (run_cmd_rtn == 127)
-		{
-			/* here for clarity and in case execute_command changes */
-			fprintf(stderr, "%s: 1: %s: not found\n", argv[0], tokens[0]);
-		}
-		else if (run_cmd_rtn == -1)
-		{
-			perror("fork failed");
-		}
-		else if (run_cmd_rtn == 2)
-			;
-		else
-		{
-			/* Other execve errors: use perror to print a descriptive message */
-			fprintf(stderr, "%s: 1: %s: ", argv[0], tokens[0]);
-			errno = run_cmd_rtn; /* Set errno, to error code */
-			perror("");			 /* Use an empty string with perror */
-		}
-
-		if (!isAtty)
-		{
-			/* use run_cmd_rtn exit status. */
-			resetAll(tokens, input, NULL);
-			safeExit(run_cmd_rtn);
-		}
+		run_batches(cmd, full_path);
+		return;
+	}
+	if (shell.tail_exec) /* nothing runs after it: skip the fork */
+	{
+		fflush(stdout);
+		if (apply_redirections(cmd->redirs, cmd->nredirs, NULL) == -1)
+			safeExit(1);
+		execve(full_path, tokens, cmd_envp(cmd));
+		perror("execve"); /* the redirections are in place: no retry */
+		_exit(errno == ENOENT ? 127 : 126);
 	}
+	shell.status = execute_command(full_path, cmd);
+	if (shell.status == -1)
+		shell.status = 1; /* fork failed, already reported */
 }
 
 /**
@@ -141,22 +262,38 @@ void resetAll(char **tokens, ...)
 }
 
 /**
- * safeExit - exits after freeing environ
+ * safeExit - exits the shell
  * @exit_code: exit code for exit()
  *
+ * Description: the process is going away, so the environment store is
+ * only freed in leak-check builds (-DHSH_LEAK_CHECK), where Valgrind
+ * should see nothing left. In a forked child ("(exit 3)", a pipeline
+ * stage) it is childExit() instead.
+ *
  * Return: void
  */
 void safeExit(int exit_code)
 {
-	int i;
-
-	if (environ)
-	{
-		for (i = 0; environ[i] != NULL; i++)
-			free(environ[i]);
-		free(environ);
-		environ = NULL;
-	}
-
+	if (getpid() != shell.pid)
+		childExit(exit_code);
+#ifdef HSH_LEAK_CHECK
+	plugin_free();
+	env_free();
+#endif
 	exit(exit_code);
 }
+
+/**
+ * childExit - ends a forked child of the shell
+ * @exit_code: exit status
+ *
+ * Description: the child shares the script's fd, and its offset, with
+ * the shell; exit() would sync the script FILE and move that offset
+ * back to what the child had consumed, so the shell would read lines
+ * again. Only stdout is flushed before _exit().
+ */
+void childExit(int exit_code)
+{
+	fflush(stdout);
+	_exit(exit_code);
+}
@@ -1,12 +1,20 @@
 #ifndef MAIN_H
 #define MAIN_H
 
+#define _GNU_SOURCE	   /* For pipe2() and other Linux extensions */
+
 /* ↓ LIBRARIES ↓ */
 #include <ctype.h>	   /* For isspace() in trim_whitespace() */
+#include <dirent.h>	   /* For getdents64() in glob.c */
+#include <dlfcn.h>	   /* For dlopen() in plugin.c */
 #include <errno.h>	   /* For errno */
 #include <fcntl.h>	   /* For open(), fcntl() - if you use them */
 #include <limits.h>	   /* For PATH_MAX */
+#include <pthread.h>   /* For the globstar walker threads */
+#include <pwd.h>	   /* For getpwnam() in tilde expansion */
+#include <sched.h>	   /* For sched_yield() */
 #include <stdbool.h>   /* For bool type */
+#include <stdint.h>    /* For uint64_t */
 #include <stdarg.h>	   /* For va_list, va_start, va_arg, va_end */
 #include <stdio.h>	   /* For printf, fprintf, perror, getline etc */
 #include <stdlib.h>	   /* For malloc, free, realloc, exit, getenv */
@@ -15,7 +23,9 @@
 #include <sys/wait.h>  /* For waitpid, WIFEXITED, WEXITSTATUS */
 #include <unistd.h>    /* For isatty, fork, execve, chdir, getcwd, etc.. */
 #include <sys/stat.h>  /* For stat and S_ISDIR */
+#include <time.h>	   /* For time() */
 #include "colors.h"
+#include "hsh_plugin.h"
 
 /* ↓ STRUCTS AND MISC ↓ */
 
@@ -33,21 +43,386 @@ typedef struct path_s
 } path_t;
 
 /**
- * typedef enum SeparatorType - Enumeration for command separators
- * @SEP_NONE: No separator.
- * @SEP_SEMICOLON: Semicolon separator (;).
- * @SEP_AND: Logical AND separator (&&).
- * @SEP_OR: Logical OR separator (||).
+ * struct shell_s - state shared by the whole shell process
+ * @name: name of the shell or script ($0)
+ * @status: exit status of the last command ($?)
+ * @argc: number of positional parameters ($#)
+ * @argv: positional parameters, @argv[0] is $1
+ * @tail_exec: set while running the last line of "-c"; a lone external
+ * command then replaces the shell instead of forking
+ * @interactive: 1 when reading commands from a terminal
+ * @input: stream command lines are read from; here-document bodies are
+ * read from it too
+ * @options: "set -o" options, a mask of shell_option_t
+ * @last_bg: pid of the last command started with '&' ($!), 0 if none
+ * @pid: pid of the shell itself ($$), the same in subshells
+ * @path_gen: bumped whenever PATH (or the directory relative PATH
+ * entries are resolved from) changes; cached command paths from an
+ * older generation are looked up again
+ * @subst_status: exit status of the last command substitution of the
+ * command being expanded, -1 if none ran; a command with no name
+ * returns it
+ *
+ * Description: one instance, "shell", defined in main.c
+ */
+typedef struct shell_s
+{
+	char *name;
+	int status;
+	int argc;
+	char **argv;
+	int tail_exec;
+	int interactive;
+	FILE *input;
+	int options;
+	pid_t last_bg;
+	pid_t pid;
+	unsigned long path_gen;
+	int subst_status;
+} shell_t;
+
+extern shell_t shell;
+
+/**
+ * enum shell_option_e - options turned on with "set -o NAME"
+ * @OPT_APPENDCACHE: keep ">>" targets open across commands
+ * @OPT_AUTOBATCH: split a command whose arguments overflow ARG_MAX into
+ * several runs, as if it were prefixed with "batch"
+ */
+typedef enum shell_option_e
+{
+	OPT_APPENDCACHE = 1 << 0,
+	OPT_AUTOBATCH = 1 << 1
+} shell_option_t;
+
+/**
+ * enum redir_op_e - kinds of redirection
+ * @REDIR_IN: n<file
+ * @REDIR_OUT: n>file
+ * @REDIR_APPEND: n>>file
+ * @REDIR_DUP: n>&m or n<&m
+ * @REDIR_CLOSE: n>&- or n<&-
+ * @REDIR_RDWR: n<>file
+ * @REDIR_BOTH: &>file (stdout and stderr)
+ * @REDIR_BOTH_APPEND: &>>file
+ * @REDIR_HEREDOC: n<<delim
+ */
+typedef enum redir_op_e
+{
+	REDIR_IN,
+	REDIR_OUT,
+	REDIR_APPEND,
+	REDIR_DUP,
+	REDIR_CLOSE,
+	REDIR_RDWR,
+	REDIR_BOTH,
+	REDIR_BOTH_APPEND,
+	REDIR_HEREDOC
+} redir_op_t;
+
+/**
+ * struct redir_s - one parsed redirection
+ * @fd: fd being redirected
+ * @op: what to do with it
+ * @target: file name, the source fd as text for REDIR_DUP, or the body
+ * for REDIR_HEREDOC
+ */
+typedef struct redir_s
+{
+	int fd;
+	redir_op_t op;
+	char *target;
+} redir_t;
+
+/**
+ * struct array_assign_s - a NAME[subscript]=value or NAME=(...) word
+ * @name: NAME
+ * @subscript: expanded subscript of NAME[subscript]=value, NULL for
+ * NAME=(...)
+ * @value: expanded value of NAME[subscript]=value
+ * @keys: NAME=(...) only, the expanded [key]= of each element, NULL
+ * where there was none
+ * @elems: NAME=(...) only, the expanded elements
+ * @nelems: number of @elems
+ */
+typedef struct array_assign_s
+{
+	char *name;
+	char *subscript;
+	char *value;
+	char **keys;
+	char **elems;
+	int nelems;
+} array_assign_t;
+
+typedef struct array_s array_t; /* an array variable's value, arrays.c */
+
+/**
+ * struct command_s - one simple command, ready to run
+ * @argv: NULL terminated words, redirections removed
+ * @argc: number of words
+ * @redirs: redirection plan, applied left to right
+ * @nredirs: number of redirections
+ * @words: storage the words and file names point into
+ * @builtin: 1 if argv[0] is a builtin
+ * @path: full path of argv[0] if it is an external command, NULL if it
+ * was not found; owned by the AST node
+ * @argsize: bytes the argv strings and pointers take in execve()
+ * @split_first: first argv entry produced by a word that expanded to
+ * several fields (a glob, an unquoted $VAR), -1 if there is none
+ * @split_end: one past the last such entry
+ * @batch: 0, or the number of batches that may run at once when the
+ * command was prefixed with "batch"
+ * @assigns: the expanded "NAME=value" words before the command name
+ * @nassigns: number of @assigns
+ * @arrays: the array assignments among them, which are never exported
+ * @narrays: number of @arrays
+ * @assign_failed: 1 if an assignment carried out while the command was
+ * built (see build_command()) failed
+ *
+ * Description: filled by build_command(); everything it points to lives
+ * in the per-line arena
+ */
+typedef struct command_s
+{
+	char **argv;
+	int argc;
+	redir_t *redirs;
+	int nredirs;
+	char *words;
+	int builtin;
+	char *path;
+	size_t argsize;
+	int split_first;
+	int split_end;
+	int batch;
+	char **assigns;
+	int nassigns;
+	array_assign_t *arrays;
+	int narrays;
+	int assign_failed;
+} command_t;
+
+/**
+ * enum token_type_e - kinds of token produced by lex_line()
+ * @TOK_WORD: word, quotes and escapes still in place
+ * @TOK_REDIR: redirection operator; the next token is its target
+ * @TOK_PIPE: |
+ * @TOK_AND_IF: &&
+ * @TOK_OR_IF: ||
+ * @TOK_SEMI: ;
+ * @TOK_NEWLINE: newline
+ * @TOK_AMP: &
+ * @TOK_LPAREN: (
+ * @TOK_RPAREN: )
+ * @TOK_END: end of the line
  */
-typedef enum
+typedef enum token_type_e
 {
-	SEP_NONE,
-	SEP_SEMICOLON,
-	SEP_AND,
-	SEP_OR,
-	SEP_SEMI
-} SeparatorType;
+	TOK_WORD,
+	TOK_REDIR,
+	TOK_PIPE,
+	TOK_AND_IF,
+	TOK_OR_IF,
+	TOK_SEMI,
+	TOK_NEWLINE,
+	TOK_AMP,
+	TOK_LPAREN,
+	TOK_RPAREN,
+	TOK_END
+} token_type_t;
 
+/**
+ * struct token_s - one token: a slice of the command line
+ * @type: kind of token
+ * @start: first byte, inside the line (not NUL terminated)
+ * @len: number of bytes
+ * @op: redirection kind, for TOK_REDIR
+ * @fd: fd being redirected, for TOK_REDIR
+ * @body: malloc'd here-document body, for a "<<" TOK_REDIR
+ */
+typedef struct token_s
+{
+	token_type_t type;
+	const char *start;
+	size_t len;
+	redir_op_t op;
+	int fd;
+	char *body;
+} token_t;
+
+/**
+ * enum node_type_e - kinds of AST node
+ * @N_COMMAND: simple command, a range of tokens
+ * @N_PIPE: left | right
+ * @N_AND: left && right
+ * @N_OR: left || right
+ * @N_SEQ: left ; right
+ * @N_NOT: ! left
+ * @N_COPROC: coproc [NAME] left
+ * @N_BACKGROUND: left &
+ * @N_SUBSHELL: ( left )
+ */
+typedef enum node_type_e
+{
+	N_COMMAND,
+	N_PIPE,
+	N_AND,
+	N_OR,
+	N_SEQ,
+	N_NOT,
+	N_COPROC,
+	N_BACKGROUND,
+	N_SUBSHELL
+} node_type_t;
+
+/**
+ * struct node_s - AST node built by parse_tokens()
+ * @type: kind of node
+ * @left: first child
+ * @right: second child
+ * @tok: N_COMMAND: its first token; N_COPROC: the NAME token (the
+ * coproc word, with ntok 0, when there is none)
+ * @ntok: number of tokens at @tok
+ * @name: N_COMMAND: the argv[0] the next fields were worked out for
+ * @builtin: 1 if @name is a builtin
+ * @path: full path of @name if it is an external command, else NULL
+ * @path_gen: shell.path_gen when @path was resolved
+ * @patterns: N_COMMAND: compiled ${VAR#pattern}-style patterns of its
+ * words that have no expansions in them
+ *
+ * Description: cached trees are run many times, so a command node
+ * remembers how its command name resolved and what its patterns
+ * compiled to; runs skip the PATH search while the name and PATH are
+ * unchanged, and never compile a constant pattern twice.
+ */
+typedef struct node_s
+{
+	node_type_t type;
+	struct node_s *left;
+	struct node_s *right;
+	token_t *tok;
+	int ntok;
+	char *name;
+	int builtin;
+	char *path;
+	unsigned long path_gen;
+	struct pattern_s *patterns;
+} node_t;
+
+/**
+ * struct ast_entry_s - one command line in the parse cache
+ * @hash: wyhash of the line
+ * @line: private copy of the line; the tokens point into it
+ * @len: length of @line
+ * @tokens: tokens from lex_line()
+ * @ntok: number of tokens
+ * @tree: AST from parse_tokens()
+ * @used: use counter value at the last lookup, for LRU eviction
+ * @busy: number of runLine() calls running the tree right now
+ */
+typedef struct ast_entry_s
+{
+	uint64_t hash;
+	char *line;
+	size_t len;
+	token_t *tokens;
+	int ntok;
+	node_t *tree;
+	unsigned long used;
+	int busy;
+} ast_entry_t;
+
+/**
+ * enum glob_op_type_e - kinds of step in a compiled glob pattern
+ * @GLOB_CHAR: one given byte
+ * @GLOB_ANY: any one byte (?)
+ * @GLOB_STAR: any run of bytes (*)
+ * @GLOB_SET: one byte from a bracket expression ([...])
+ */
+typedef enum glob_op_type_e
+{
+	GLOB_CHAR,
+	GLOB_ANY,
+	GLOB_STAR,
+	GLOB_SET
+} glob_op_type_t;
+
+/**
+ * struct glob_op_s - one step of a compiled pattern component
+ * @type: GLOB_CHAR, GLOB_ANY, GLOB_STAR or GLOB_SET
+ * @c: the byte for GLOB_CHAR
+ * @set: 256-bit membership map for GLOB_SET
+ */
+typedef struct glob_op_s
+{
+	unsigned char type;
+	unsigned char c;
+	const unsigned char *set;
+} glob_op_t;
+
+/**
+ * struct pattern_s - a compiled parameter expansion pattern, kept by
+ * the AST node whose word it is in
+ * @src: pattern text in the word, which identifies it
+ * @len: length of @src
+ * @ops: compiled pattern, one malloc'd block (glob_keep())
+ * @nops: number of @ops
+ * @next: next pattern of the node
+ */
+typedef struct pattern_s
+{
+	const char *src;
+	size_t len;
+	glob_op_t *ops;
+	int nops;
+	struct pattern_s *next;
+} pattern_t;
+
+/**
+ * struct strbuf_s - growable, always NUL terminated string
+ * @data: bytes, NULL until the first append
+ * @len: number of bytes used, excluding the NUL
+ * @cap: bytes allocated
+ *
+ * Description: zero-initialize ({NULL, 0, 0}) before use; the bytes live
+ * in the per-line arena, so they are never freed
+ */
+typedef struct strbuf_s
+{
+	char *data;
+	size_t len;
+	size_t cap;
+} strbuf_t;
+
+/**
+ * enum builtin_flag_e - what a builtin does besides writing output
+ * @BI_PURE: only writes to stdout and never changes shell state, so it
+ * can run in-process inside $(...)
+ * @BI_EXIT: ends the shell
+ */
+typedef enum builtin_flag_e
+{
+	BI_PURE = HSH_BI_PURE,
+	BI_EXIT = 1 << 1
+} builtin_flag_t;
+
+/**
+ * struct builtin_s - an entry of the builtin table
+ * @name: command name
+ * @run: handler, NULL for exit/quit (which also need the interactive
+ * flag) and exec (run by executeIfValid())
+ * @flags: builtin_flag_t bits
+ * @plugin: for a builtin loaded with "enable -f", its function (and
+ * @run is NULL); NULL otherwise
+ */
+typedef struct builtin_s
+{
+	const char *name;
+	int (*run)(char **tokens);
+	int flags;
+	hsh_builtin_fn plugin;
+} builtin_t;
 extern char **environ;		 /* The environment variables */
 extern char **saved_environ;
 extern char *input;
@@ -56,57 +431,138 @@ extern char **tokens;
 /* ↓ FUNCTION PROTOTYPES ↓ */
 
 /* --- Main Shell Loop and Control --- */
-void shellLoop(int isAtty, char *argv[]);
-void executeIfValid(int isAtty, char *const *argv, char **tokens, char *input);
+void shellLoop(int isAtty, FILE *stream);
+void runLine(int isAtty, const char *input);
+void runString(const char *string);
+FILE *openScript(const char *path);
+void executeIfValid(int isAtty, char *const *argv, command_t *cmd, char *input);
 void safeExit(int exit_code);
+void childExit(int exit_code);
 void printPrompt(int isAtty, char *user, char *hostname, char *path);
 
 /* --- Command Parsing --- */
-char **parse_command(char *command);
-int split_command_line_on_pipe(char *input, char ***commands, int *num_commands);
-char *trim_whitespace(char *str);
+int lex_line(const char *line, token_t **tokens);
+void free_tokens(token_t *tokens, int n);
+size_t scan_plain(const char *s);
+node_t *parse_tokens(token_t *tokens, int *error);
+void free_tree(node_t *n);
+ast_entry_t *ast_cache_lookup(const char *line);
+ast_entry_t *ast_cache_insert(const char *line, token_t *tokens, int ntok,
+							  node_t *tree);
+void ast_cache_release(ast_entry_t *e);
+int build_command(node_t *n, command_t *cmd, int assign);
+int build_compound(const char *word, array_assign_t *as);
+node_t *expand_node(node_t *n);
+int expand_word(const char *w, size_t len, strbuf_t *out, int split);
+const char *find_closing_brace(const char *s);
+int glob_expand(const char *pattern, strbuf_t *out);
+glob_op_t *glob_compile(const char *p, const char *end, int *n);
+glob_op_t *glob_keep(const glob_op_t *ops, int n);
+int glob_match(const glob_op_t *ops, int n, const char *s);
+int glob_match_n(const glob_op_t *ops, int n, const char *s, size_t len);
+int globstar_walk(const char *root, const glob_op_t *ops, int nops,
+				  strbuf_t *found);
 
 /* --- Command Execution --- */
-int execute_command(const char *commandPath, char **arguments);
-void execute_pipe_command(char **commands, int num_commands);
-void execute_logical_commands(char *line);
-void execute_commands_separated_by_semicolon(char *line);
+void run_node(node_t *n, int isAtty);
+void reap_background(void);
+int execute_command(const char *commandPath, command_t *cmd);
+int batch_prefix(command_t *cmd);
+int batch_needed(const command_t *cmd);
+int run_batched(const char *path, command_t *cmd);
+int command_substitute(const char *body, strbuf_t *out);
+int proc_subst_open(const char *cmd, char dir);
+void finish_process_substitutions(void);
+char *find_closing_paren(char *s);
 
 /* --- Built-in Command Handlers --- */
 int customCmd(char **tokens, int interactive, char *input);
+const builtin_t *builtin_find(const char *name);
+const builtin_t *plugin_find(const char *name);
+int plugin_run(const builtin_t *b, char **tokens);
+int ifCmdEnable(char **tokens);
+void plugin_free(void);
 int ifCmdCd(char **tokens);
 int ifCmdEnv(char **tokens);
 int ifCmdExit(char **tokens, int interactive, char *input);
 int ifCmdSelfDestruct(char **tokens);
 int ifCmdSetEnv(char **tokens);
+int ifCmdTrueFalse(char **tokens);
+int ifCmdSet(char **tokens);
+int isPureBuiltin(const char *name);
+int isBuiltin(const char *name);
+int ifCmdRead(char **tokens);
+int run_coproc(node_t *n);
+void reapCoprocs(void);
+void coproc_close_fds(void);
 int ifCmdUnsetEnv(char **tokens);
 void selfDestruct(int countdown);
-void freeIfCmdCd(char *previous_cwd, char *home, char *pwd);
 
 /* --- Environment Variable Handling --- */
 char *_getenv(const char *name);
 int _setenv(const char *name, const char *value, int overwrite);
 int _unsetenv(const char *name);
 void initialize_environ(void);
+char **env_array(void);
+size_t env_size(void);
+char **env_overlay(int clear, char **set, int nset, char **unset, int nunset);
+char **cmd_envp(const command_t *cmd);
+int env_assign(const command_t *cmd, int local);
+int assign_word(const char *word);
+int assign_array(const array_assign_t *as);
+int var_set(const char *name, const char *value);
+int var_append(const char *name, const char *suffix);
+int var_export(const char *name);
+char **var_entries(void);
+int var_push_scope(void);
+void var_pop_scope(void);
+void print_var(const char *prefix, const char *entry);
+void print_vars(char **list, const char *prefix);
+int ifCmdExport(char **tokens);
+int ifCmdUnset(char **tokens);
+int ifCmdDeclare(char **tokens);
+array_t *var_array(const char *name, int create);
+int array_subscript(const array_t *a, const char *sub, size_t *index);
+
+/* --- Arrays --- */
+array_t *array_new(int assoc);
+void array_clear(array_t *a);
+void array_free(array_t *a);
+int array_is_assoc(const array_t *a);
+size_t array_count(const array_t *a);
+size_t array_length(const array_t *a);
+const char *array_get(const array_t *a, const char *key, size_t index);
+int array_set(array_t *a, const char *key, size_t index, const char *value);
+void array_unset(array_t *a, const char *key, size_t index);
+char **array_list(const array_t *a, int keys);
+void env_free(void);
 path_t *buildListPath(void);
 char *findPath(char *name);
-void destroyListPath(path_t *h);
 char *getUser(void);
 char *getHostname(void);
 char* _strstr(char *sentence, char *word);
-int RightDirect(char *line);
-int DoubleRightDirect(char *line);
-int LeftDirect(char *line);
-int DoubleLeftDirect(char *line);
-int StreamDirect(char **tokens);
 int ifCmdEcho(char **tokens);
 size_t _strcspn(const char *str1, const char *str2);
+size_t _strspn_blank(const char *s);
+int apply_redirection(const redir_t *r);
+int apply_redirections(const redir_t *redirs, int n, int *saved);
+void restore_redirections(const redir_t *redirs, int n, int *saved);
+int ifCmdExec(command_t *cmd);
+int append_cache_get(const char *path);
+void append_cache_prepare(const redir_t *redirs, int n);
+void append_cache_flush(void);
 
 /* --- Utility Functions --- */
+void *arena_alloc(size_t size);
+void *arena_realloc(void *p, size_t old, size_t size);
+char *arena_strdup(const char *s, size_t len);
+void arena_reset(void);
+int sb_reserve(strbuf_t *sb, size_t extra);
+int sb_append(strbuf_t *sb, const char *s, size_t n);
+int sb_putc(strbuf_t *sb, char c);
 int isNumber(char *str);
 int _atoi_safe(const char *s);
 void resetAll(char **tokens, ...);
-void freeIfCmdCd(char *previous_cwd, char *home, char *pwd);
 int is_directory(char *fp);
 int isCommand(const char *fp);
 
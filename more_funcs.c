@@ -125,7 +125,7 @@ int runCommand(char *commandPath, char **args)
 		return (-1);	/* indicate error */
 	if (fork_rtn == 0)	/* child process */
 	{
-		if (execve(commandPath, args, environ) == -1) /*executes user-command*/
+		if (execve(commandPath, args, env_array()) == -1) /*executes user-command*/
 			safeExit(errno);						  /* indicate error */
 	}
 	else /* parent process; fork_rtn contains pid of child process */
@@ -1,23 +1,5 @@
 #include "main.h"
 
-/**
- * freeIfCmdCd - frees previous_cwd, home, and pwd inn ifCmdCd
- * @previous_cwd: malloced string from _getenv("OLDPWD")
- * @home: malloced string from _getenv("HOME")
- * @pwd: malloced string form _getenv("PWD")
- *
- * Return: void
- */
-void freeIfCmdCd(char *previous_cwd, char *home, char *pwd)
-{
-	if (previous_cwd)
-		free(previous_cwd);
-	if (home)
-		free(home);
-	if (pwd)
-		free(pwd);
-}
-
 char* _strstr(char *sentence, char *word)
 {
 	if (!word)
@@ -55,3 +37,18 @@ size_t _strcspn(const char *str1, const char *str2)
 	}
 	return (s - str1);
 }
+
+/**
+ * _strspn_blank - counts the spaces and tabs at the start of a string
+ * @s: string
+ *
+ * Return: number of leading blanks
+ */
+size_t _strspn_blank(const char *s)
+{
+	size_t n = 0;
+
+	while (s[n] == ' ' || s[n] == '\t')
+		n++;
+	return (n);
+}
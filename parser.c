@@ -1,147 +1,409 @@
 #include "main.h"
 
 /**
- * split_command_line_on_pipe - Splits the command line into two commands
- *                              based on the pipe symbol without using strchr.
- * @line: The command line string.
- * @command1: Pointer to store the first command (before the pipe).
- * @command2: Pointer to store the second command (after the pipe).
+ * struct parser_s - state of one recursive-descent parse
+ * @tok: tokens from lex_line(), ending with TOK_END
+ * @pos: index of the next token
+ * @error: set once a syntax error has been reported
+ */
+typedef struct parser_s
+{
+	token_t *tok;
+	int pos;
+	int error;
+} parser_t;
+
+/**
+ * new_node - allocates an AST node
+ * @type: node type
+ * @left: first child, or NULL
+ * @right: second child, or NULL
  *
- * Return: 0 if a pipe symbol is found and the line is split, -1 otherwise.
+ * Return: the node, NULL if malloc failed
  */
-int split_command_line_on_pipe(char *input, char ***commands, int *num_commands)
+static node_t *new_node(node_type_t type, node_t *left, node_t *right)
 {
-	char *token;
-	int count = 0;
-	char *input_copy;
+	node_t *n = malloc(sizeof(node_t));
 
-	/* Count the number of pipes */
-	for (int i = 0; input[i] != '\0'; i++)
+	if (n == NULL)
 	{
-		if (input[i] == '|')
-		{
-			count++;
-		}
+		perror("malloc");
+		free_tree(left);
+		free_tree(right);
+		return (NULL);
 	}
+	n->type = type;
+	n->left = left;
+	n->right = right;
+	n->tok = NULL;
+	n->ntok = 0;
+	n->name = NULL;
+	n->builtin = 0;
+	n->path = NULL;
+	n->path_gen = 0;
+	n->patterns = NULL;
+	return (n);
+}
 
-	/* Allocate memory for commands array + NULL terminator */
-	*commands = malloc(sizeof(char *) * (count + 2));
-	if (*commands == NULL)
+/**
+ * syntax_error - reports the token the parser could not use
+ * @p: parser state
+ *
+ * Return: NULL, for the caller to return
+ */
+static node_t *syntax_error(parser_t *p)
+{
+	token_t *t = &p->tok[p->pos];
+
+	if (!p->error)
 	{
-		perror("malloc");
-		return -1;
+		if (t->type == TOK_END)
+			fprintf(stderr, "%s: 1: Syntax error: end of file unexpected\n",
+					shell.name);
+		else if (t->type == TOK_NEWLINE)
+			fprintf(stderr, "%s: 1: Syntax error: newline unexpected\n",
+					shell.name);
+		else
+			fprintf(stderr, "%s: 1: Syntax error: \"%.*s\" unexpected\n",
+					shell.name, (int)t->len, t->start);
 	}
+	p->error = 1;
+	return (NULL);
+}
+
+/**
+ * is_word - tells whether the next token is a given unquoted word
+ * @p: parser state
+ * @word: reserved word to look for
+ *
+ * Return: 1 if it is, 0 otherwise
+ */
+static int is_word(parser_t *p, const char *word)
+{
+	token_t *t = &p->tok[p->pos];
+
+	return (t->type == TOK_WORD && (int)t->len == _strlen(word) &&
+			_strncmp(t->start, word, t->len) == 0);
+}
+
+/**
+ * read_heredoc - reads a here-document body from the shell's input
+ * @delim: word after "<<"; quotes in it are removed
+ *
+ * Return: body in the line arena (lines keep their newlines), NULL on error
+ */
+static char *read_heredoc(const token_t *delim)
+{
+	strbuf_t body = {NULL, 0, 0}, end = {NULL, 0, 0};
+	char *line = NULL;
+	size_t size = 0, i;
+	ssize_t len;
 
-	input_copy = _strdup(input); /* Duplicate the input string */
-	if (input_copy == NULL)
+	for (i = 0; i < delim->len; i++)
+		if (delim->start[i] != '\'' && delim->start[i] != '"' &&
+			delim->start[i] != '\\' && sb_putc(&end, delim->start[i]) == -1)
+			return (NULL);
+	if (sb_reserve(&body, 0) == -1 || sb_reserve(&end, 0) == -1)
+		return (NULL);
+	while (shell.input != NULL)
 	{
-		perror("_strdup");
-		free(*commands);
-		return -1;
+		if (shell.interactive)
+			printf("> "), fflush(stdout);
+		len = getline(&line, &size, shell.input);
+		if (len == -1)
+			break;
+		if (len > 0 && line[len - 1] == '\n')
+			line[--len] = '\0';
+		if (_strcmp(line, end.data) == 0)
+			break;
+		if (sb_append(&body, line, len) == -1 || sb_putc(&body, '\n') == -1)
+			break;
 	}
-	token = strtok(input_copy, "|"); /* Tokenize based on pipe*/
+	free(line);
+	return (body.data);
+}
+
+/**
+ * parse_command - simple_command: (WORD | REDIR WORD)+
+ * @p: parser state
+ *
+ * Description: the node keeps the range of tokens; words are expanded
+ * only when the command runs. Here-document bodies are read now, from
+ * the lines that follow.
+ *
+ * Return: N_COMMAND node, NULL on error
+ */
+static node_t *parse_command(parser_t *p)
+{
+	node_t *n;
+	int start = p->pos;
+	token_t *t;
 
-	int i = 0;
-	while (token != NULL)
+	while (1)
 	{
-		(*commands)[i] = _strdup(token); /* Duplicate and store each token */
-		if ((*commands)[i] == NULL)
+		t = &p->tok[p->pos];
+		if (t->type == TOK_REDIR)
 		{
-			perror("_strdup");
-			/* Free previously allocated memory before returning */
-			for (int j = 0; j < i; j++)
+			if (t[1].type != TOK_WORD)
 			{
-				free((*commands)[j]);
+				p->pos++;
+				return (syntax_error(p));
 			}
-			free(*commands);
-			free(input_copy);
-			return -1;
+			if (t->op == REDIR_HEREDOC)
+			{
+				t->body = read_heredoc(&t[1]);
+				if (t->body == NULL)
+					return (NULL);
+			}
+			p->pos += 2;
 		}
-		i++;
-		token = strtok(NULL, "|"); /* get next command */
+		else if (t->type == TOK_WORD)
+			p->pos++;
+		else
+			break;
+	}
+	if (p->pos == start)
+		return (syntax_error(p));
+	n = new_node(N_COMMAND, NULL, NULL);
+	if (n != NULL)
+	{
+		n->tok = &p->tok[start];
+		n->ntok = p->pos - start;
 	}
+	return (n);
+}
+
+static node_t *parse_list(parser_t *p);
 
-	(*commands)[i] = NULL; /* Null-terminate array */
-	*num_commands = i;	   /* sets number of commands */
-	free(input_copy);
-	return 0; /* success */
+/**
+ * parse_primary - command: simple_command | '(' list ')'
+ * @p: parser state
+ *
+ * Return: node, NULL on error
+ */
+static node_t *parse_primary(parser_t *p)
+{
+	node_t *list;
+
+	if (p->tok[p->pos].type != TOK_LPAREN)
+		return (parse_command(p));
+	p->pos++;
+	list = parse_list(p);
+	if (list == NULL || p->tok[p->pos].type != TOK_RPAREN)
+	{
+		free_tree(list);
+		return (syntax_error(p));
+	}
+	p->pos++;
+	return (new_node(N_SUBSHELL, list, NULL));
 }
 
 /**
- * parse_command - Parses a command string into an array of arguments.
- * @command: The command string.
+ * coproc_name - tells whether the word after "coproc" is its NAME
+ * @p: parser state, at that word
  *
- * Return: A NULL-terminated array of strings (arguments) or NULL on error.
+ * Description: it is when it is a valid name and a command follows it,
+ * so "coproc cat" and "coproc (cmd)" have no NAME.
+ *
+ * Return: 1 if it is, 0 otherwise
  */
-char **parse_command(char *command)
+static int coproc_name(parser_t *p)
 {
-	int bufsize = 64, position = 0, i;
-	char **tokens = malloc(bufsize * sizeof(char *));
-	char *token;
+	token_t *t = &p->tok[p->pos];
+	size_t i;
+
+	if (t->type != TOK_WORD || (p->tok[p->pos + 1].type != TOK_WORD &&
+								p->tok[p->pos + 1].type != TOK_LPAREN) ||
+		isdigit((unsigned char)t->start[0]))
+		return (0);
+	for (i = 0; i < t->len; i++)
+		if (!isalnum((unsigned char)t->start[i]) && t->start[i] != '_')
+			return (0);
+	return (1);
+}
 
-	for (i = 0; i < bufsize; i++)
-		tokens[i] = NULL;
-	if (!tokens)
+/**
+ * parse_pipeline - pipeline: ['!'] command ('|' linebreak command)*
+ * or "coproc [NAME] pipeline"
+ * @p: parser state
+ *
+ * Return: node, NULL on error
+ */
+static node_t *parse_pipeline(parser_t *p)
+{
+	node_t *left, *right;
+	int negate = 0;
+
+	if (is_word(p, "coproc") && (p->tok[p->pos + 1].type == TOK_WORD ||
+								 p->tok[p->pos + 1].type == TOK_LPAREN))
 	{
-		fprintf(stderr, "hsh: allocation error\n");
-		exit(EXIT_FAILURE);
+		left = new_node(N_COPROC, NULL, NULL);
+		if (left == NULL)
+			return (NULL);
+		left->tok = &p->tok[p->pos++]; /* ntok 0: the default NAME */
+		if (coproc_name(p))
+		{
+			left->tok = &p->tok[p->pos++];
+			left->ntok = 1;
+		}
+		left->left = parse_pipeline(p);
+		if (left->left == NULL)
+		{
+			free_tree(left);
+			return (NULL);
+		}
+		return (left);
 	}
+	if (is_word(p, "!"))
+	{
+		negate = 1;
+		p->pos++;
+	}
+	left = parse_primary(p);
+	while (left != NULL && p->tok[p->pos].type == TOK_PIPE)
+	{
+		p->pos++;
+		while (p->tok[p->pos].type == TOK_NEWLINE)
+			p->pos++;
+		right = parse_primary(p);
+		if (right == NULL)
+		{
+			free_tree(left);
+			return (NULL);
+		}
+		left = new_node(N_PIPE, left, right);
+	}
+	if (left != NULL && negate)
+		left = new_node(N_NOT, left, NULL);
+	return (left);
+}
 
-	token = strtok(command, " \t\r\n\a");
-	while (token != NULL)
+/**
+ * parse_and_or - and_or: pipeline (('&&' | '||') linebreak pipeline)*
+ * @p: parser state
+ *
+ * Return: node, NULL on error
+ */
+static node_t *parse_and_or(parser_t *p)
+{
+	node_t *left = parse_pipeline(p), *right;
+	node_type_t type;
+
+	while (left != NULL && (p->tok[p->pos].type == TOK_AND_IF ||
+							p->tok[p->pos].type == TOK_OR_IF))
 	{
-		tokens[position] = token;
-		position++;
+		type = p->tok[p->pos].type == TOK_AND_IF ? N_AND : N_OR;
+		p->pos++;
+		while (p->tok[p->pos].type == TOK_NEWLINE)
+			p->pos++;
+		right = parse_pipeline(p);
+		if (right == NULL)
+		{
+			free_tree(left);
+			return (NULL);
+		}
+		left = new_node(type, left, right);
+	}
+	return (left);
+}
+
+/**
+ * parse_list - list: and_or ((';' | '&' | newline) and_or)* [separator]
+ * @p: parser state
+ *
+ * Description: blank lines are skipped; a ';' has to follow an item,
+ * so a leading ';', ";;" or a bare "&&" is a syntax error. The list
+ * ends at the end of the line or at a ')', which is left for the
+ * caller.
+ *
+ * Return: node, NULL for an empty list or on error (p->error set)
+ */
+static node_t *parse_list(parser_t *p)
+{
+	node_t *list = NULL, *item;
+	token_type_t sep;
 
-		if (position >= bufsize)
+	while (!p->error)
+	{
+		sep = p->tok[p->pos].type;
+		if (sep == TOK_NEWLINE)
 		{
-			bufsize += 64;
-			tokens = realloc(tokens, bufsize * sizeof(char *));
-			if (!tokens)
-			{
-				fprintf(stderr, "hsh: allocation error\n");
-				exit(EXIT_FAILURE);
-			}
+			p->pos++;
+			continue;
+		}
+		if (sep == TOK_END || sep == TOK_RPAREN)
+			break;
+		item = parse_and_or(p);
+		sep = item != NULL ? p->tok[p->pos].type : TOK_END;
+		if (sep == TOK_AMP) /* "a & b": a runs in the background */
+		{
+			p->pos++;
+			item = new_node(N_BACKGROUND, item, NULL);
 		}
+		else if (sep == TOK_SEMI && p->tok[p->pos].len == 1)
+			p->pos++;
+		else if (sep != TOK_NEWLINE && sep != TOK_END && sep != TOK_RPAREN)
+			syntax_error(p);
+		if (item == NULL)
+		{
+			p->error = 1;
+			break;
+		}
+		list = list == NULL ? item : new_node(N_SEQ, list, item);
+		if (list == NULL)
+			p->error = 1;
+	}
+	if (p->error)
+	{
+		free_tree(list);
+		return (NULL);
+	}
+	return (list);
+}
 
-		token = strtok(NULL, " \t\r\n\a");
+/**
+ * parse_tokens - builds the AST of one command line
+ * @tokens: tokens from lex_line(); here-document bodies are stored in them
+ * @error: set to 1 on a syntax error, 0 otherwise
+ *
+ * Return: root node, NULL if the line is empty or on error
+ */
+node_t *parse_tokens(token_t *tokens, int *error)
+{
+	parser_t p = {NULL, 0, 0};
+	node_t *tree;
+
+	p.tok = tokens;
+	tree = parse_list(&p);
+	if (!p.error && tokens[p.pos].type != TOK_END) /* a stray ")" */
+	{
+		syntax_error(&p);
+		free_tree(tree);
+		tree = NULL;
 	}
-	tokens[position] = NULL;
-	
-	/* printf("%s\n", tokens[0]); */
-	return tokens;
+	*error = p.error;
+	return (tree);
 }
 
-// /**
-//  * trim_whitespace - Removes leading and trailing whitespace from a string.
-//  * @str: The string to trim.
-//  *
-//  * Return: A pointer to the trimmed string (within the original string).
-//  */
-// char *trim_whitespace(char *str)
-// {
-// 	char *end;
-
-// 	/* Trim leading space */
-// 	while (isspace((unsigned char)*str))
-// 	{
-// 		str++;
-// 	}
-
-// 	if (*str == 0)
-// 	{ /* All spaces? */
-// 		return str;
-// 	}
-
-// 	/* Trim trailing space */
-// 	end = str + strlen(str) - 1;
-// 	while (end > str && isspace((unsigned char)*end))
-// 	{
-// 		end--;
-// 	}
-
-// 	/* Write new null terminator character */
-// 	end[1] = '\0';
-
-// 	return str;
-// }
+/**
+ * free_tree - frees an AST (not the tokens it points into)
+ * @n: root node, may be NULL
+ */
+void free_tree(node_t *n)
+{
+	pattern_t *next;
+
+	if (n == NULL)
+		return;
+	free_tree(n->left);
+	free_tree(n->right);
+	for (; n->patterns != NULL; n->patterns = next)
+	{
+		next = n->patterns->next;
+		free(n->patterns->ops);
+		free(n->patterns);
+	}
+	free(n->name);
+	free(n->path);
+	free(n);
+}
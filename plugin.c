@@ -0,0 +1,413 @@
+#include "main.h"
+
+#define PLUGIN_LIBS 16
+#define PLUGIN_BUILTINS 64
+#define PLUGIN_FLAGS HSH_BI_PURE
+
+/**
+ * struct plugin_lib_s - a shared object loaded by "enable -f"
+ * @path: path it was loaded from, as given
+ * @handle: dlopen() handle, NULL for a free slot
+ * @enabled: number of its builtins that are enabled
+ */
+typedef struct plugin_lib_s
+{
+	char *path;
+	void *handle;
+	int enabled;
+} plugin_lib_t;
+
+/**
+ * struct plugin_builtin_s - a builtin a plugin registered
+ * @b: its entry, as builtin_find() returns it; the name is malloc'd
+ * @lib: its library, an index in libs
+ * @enabled: 1 while it runs as a command
+ */
+typedef struct plugin_builtin_s
+{
+	builtin_t b;
+	int lib;
+	int enabled;
+} plugin_builtin_t;
+
+/**
+ * struct hsh_call_s - one run of a plugin builtin
+ * @argv: its words, NULL terminated
+ * @argc: number of @argv
+ */
+struct hsh_call_s
+{
+	char **argv;
+	int argc;
+};
+
+static plugin_lib_t libs[PLUGIN_LIBS];
+static plugin_builtin_t regs[PLUGIN_BUILTINS];
+static int nregs, nenabled, loading = -1;
+
+/**
+ * plugin_find - looks a name up among the enabled plugin builtins
+ * @name: command name
+ *
+ * Description: a short linear scan, and none at all until something is
+ * enabled; resolve_command() remembers the answer per AST node anyway.
+ *
+ * Return: its entry, NULL if there is none
+ */
+const builtin_t *plugin_find(const char *name)
+{
+	int i;
+
+	for (i = 0; nenabled > 0 && i < nregs; i++)
+		if (regs[i].enabled && _strcmp(regs[i].b.name, name) == 0)
+			return (&regs[i].b);
+	return (NULL);
+}
+
+/**
+ * plugin_run - runs a plugin builtin, setting shell.status to what it
+ * returned
+ * @b: its entry
+ * @tokens: its words
+ *
+ * Return: 1, as for any builtin that ran
+ */
+int plugin_run(const builtin_t *b, char **tokens)
+{
+	hsh_call_t call;
+
+	call.argv = tokens;
+	for (call.argc = 0; tokens[call.argc] != NULL; call.argc++)
+		;
+	shell.status = b->plugin(&call) & 0xff;
+	return (1);
+}
+
+/**
+ * hsh_builtin_register - adds a builtin; only valid in hsh_plugin_init()
+ * @name: command name, copied; it may not be a shell builtin's
+ * @fn: function run for it
+ * @flags: HSH_BI_* bits
+ *
+ * Description: the builtin is enabled by the "enable -f" that loaded
+ * the plugin, if that names it (or names nothing).
+ *
+ * Return: 0 on success, -1 on a bad name, a full table or out of memory
+ */
+int hsh_builtin_register(const char *name, hsh_builtin_fn fn, int flags)
+{
+	const builtin_t *b = name != NULL ? builtin_find(name) : NULL;
+	plugin_builtin_t *r = &regs[nregs];
+
+	if (loading == -1 || name == NULL || *name == '\0' || fn == NULL ||
+		_strchr(name, '/') || _strchr(name, '=') || (b && !b->plugin) ||
+		nregs == PLUGIN_BUILTINS)
+		return (-1);
+	r->b.name = _strdup(name);
+	if (r->b.name == NULL)
+		return (-1);
+	r->b.run = NULL;
+	r->b.flags = flags & PLUGIN_FLAGS;
+	r->b.plugin = fn;
+	r->lib = loading;
+	r->enabled = 0;
+	nregs++;
+	return (0);
+}
+
+/**
+ * hsh_argc - number of words of a builtin's command
+ * @call: the run
+ *
+ * Return: argc, counting the name
+ */
+int hsh_argc(const hsh_call_t *call)
+{
+	return (call->argc);
+}
+
+/**
+ * hsh_argv - words of a builtin's command
+ * @call: the run
+ *
+ * Return: NULL terminated argv, valid until the builtin returns
+ */
+char *const *hsh_argv(const hsh_call_t *call)
+{
+	return (call->argv);
+}
+
+/**
+ * hsh_fd - the descriptor a builtin's fd n is
+ * @call: the run
+ * @n: fd as the command sees it (0, 1, 2 or one it redirected)
+ *
+ * Description: builtins run with their redirections applied to the
+ * shell's own fds (run_builtin()), so that is n itself.
+ *
+ * Return: descriptor
+ */
+int hsh_fd(const hsh_call_t *call, int n)
+{
+	(void)call;
+	return (n);
+}
+
+/**
+ * hsh_write - writes to a builtin's fd n
+ * @call: the run
+ * @n: fd as the command sees it
+ * @buf: bytes
+ * @len: number of @buf
+ *
+ * Description: fds 1 and 2 go through stdout and stderr, so the output
+ * stays in order with the shell's own and $(...) captures it.
+ *
+ * Return: len on success, -1 on error
+ */
+long hsh_write(hsh_call_t *call, int n, const void *buf, size_t len)
+{
+	FILE *f = n == 1 ? stdout : n == 2 ? stderr : NULL;
+
+	if (f != NULL)
+		return (fwrite(buf, 1, len, f) == len ? (long)len : -1);
+	return ((long)write(hsh_fd(call, n), buf, len));
+}
+
+/**
+ * hsh_getvar - looks up a variable
+ * @name: name
+ *
+ * Return: its value, NULL if unset
+ */
+const char *hsh_getvar(const char *name)
+{
+	return (_getenv(name));
+}
+
+/**
+ * hsh_setvar - sets a variable, as NAME=value does
+ * @name: name
+ * @value: value, copied
+ *
+ * Return: 0 on success, -1 on a bad name or out of memory
+ */
+int hsh_setvar(const char *name, const char *value)
+{
+	return (var_set(name, value));
+}
+
+/**
+ * hsh_unsetvar - removes a variable
+ * @name: name
+ *
+ * Return: 0
+ */
+int hsh_unsetvar(const char *name)
+{
+	return (_unsetenv(name));
+}
+
+/**
+ * unload_lib - forgets a library's builtins and unloads it
+ * @lib: index in libs
+ * @fini: 1 to call its hsh_plugin_fini() first
+ */
+static void unload_lib(int lib, int fini)
+{
+	void (*finish)(void) = NULL;
+	void *sym;
+	int i, n = 0;
+
+	for (i = 0; i < nregs; i++)
+	{
+		if (regs[i].lib != lib)
+			regs[n++] = regs[i];
+		else
+		{
+			nenabled -= regs[i].enabled;
+			free((char *)regs[i].b.name);
+		}
+	}
+	nregs = n;
+	sym = fini ? dlsym(libs[lib].handle, "hsh_plugin_fini") : NULL;
+	memcpy(&finish, &sym, sizeof(finish)); /* no object to function cast */
+	if (finish != NULL)
+		finish();
+	dlclose(libs[lib].handle);
+	free(libs[lib].path);
+	libs[lib].path = NULL;
+	libs[lib].handle = NULL;
+	libs[lib].enabled = 0;
+}
+
+/**
+ * load_lib - loads a plugin and has it register its builtins
+ * @path: shared object, as dlopen() takes it
+ *
+ * Return: its index in libs (also when it was loaded before), -1 on
+ * error (message printed)
+ */
+static int load_lib(const char *path)
+{
+	int (*init)(int) = NULL;
+	int i, slot = -1, rtn;
+	void *handle, *sym;
+
+	for (i = 0; i < PLUGIN_LIBS; i++)
+		if (libs[i].handle != NULL && _strcmp(libs[i].path, path) == 0)
+			return (i);
+		else if (libs[i].handle == NULL && slot == -1)
+			slot = i;
+	handle = slot != -1 ? dlopen(path, RTLD_NOW | RTLD_LOCAL) : NULL;
+	if (handle == NULL)
+	{
+		fprintf(stderr, "%s: 1: enable: %s\n", shell.name,
+				slot == -1 ? "too many plugins loaded" : dlerror());
+		return (-1);
+	}
+	sym = dlsym(handle, "hsh_plugin_init");
+	memcpy(&init, &sym, sizeof(init)); /* no object to function cast */
+	libs[slot].handle = handle;
+	libs[slot].path = _strdup(path);
+	loading = slot;
+	rtn = init == NULL || libs[slot].path == NULL ? -1 : init(HSH_PLUGIN_ABI);
+	loading = -1;
+	if (rtn != 0)
+	{
+		fprintf(stderr, "%s: 1: enable: %s: not an hsh plugin (ABI %d)\n",
+				shell.name, path, HSH_PLUGIN_ABI);
+		unload_lib(slot, 0);
+		return (-1);
+	}
+	return (slot);
+}
+
+/**
+ * enable_reg - enables a registered builtin
+ * @r: its registration
+ *
+ * Return: 0 on success, -1 if another plugin's builtin has the name
+ * (message printed)
+ */
+static int enable_reg(plugin_builtin_t *r)
+{
+	if (r->enabled)
+		return (0);
+	if (plugin_find(r->b.name) != NULL)
+	{
+		fprintf(stderr, "%s: 1: enable: %s: already enabled\n",
+				shell.name, r->b.name);
+		return (-1);
+	}
+	r->enabled = 1;
+	libs[r->lib].enabled++;
+	nenabled++;
+	return (0);
+}
+
+/**
+ * enable_from - enable -f PATH [NAME]...
+ * @path: plugin
+ * @names: builtins to enable, all it registered if there are none
+ */
+static void enable_from(const char *path, char **names)
+{
+	int lib = load_lib(path), i, found;
+
+	if (lib == -1)
+	{
+		shell.status = 1;
+		return;
+	}
+	for (i = 0; *names == NULL && i < nregs; i++)
+		if (regs[i].lib == lib && enable_reg(&regs[i]) == -1)
+			shell.status = 1;
+	for (; *names != NULL; names++)
+	{
+		for (i = 0, found = 0; !found && i < nregs; i++)
+			found = regs[i].lib == lib && _strcmp(regs[i].b.name, *names) == 0;
+		if (!found)
+			fprintf(stderr, "%s: 1: enable: %s: not found in %s\n",
+					shell.name, *names, path);
+		if (!found || enable_reg(&regs[i - 1]) == -1)
+			shell.status = 1;
+	}
+	if (libs[lib].enabled == 0)
+		unload_lib(lib, 1);
+}
+
+/**
+ * disable - enable -d NAME...: removes plugin builtins, unloading each
+ * plugin once none of its builtins is left
+ * @names: builtins
+ */
+static void disable(char **names)
+{
+	plugin_builtin_t *r;
+
+	for (; *names != NULL; names++)
+	{
+		r = (plugin_builtin_t *)plugin_find(*names); /* b comes first */
+		if (r == NULL)
+		{
+			fprintf(stderr, "%s: 1: enable: %s: not a loaded builtin\n",
+					shell.name, *names);
+			shell.status = 1;
+			continue;
+		}
+		r->enabled = 0;
+		nenabled--;
+		if (--libs[r->lib].enabled == 0)
+			unload_lib(r->lib, 1);
+	}
+}
+
+/**
+ * ifCmdEnable - enable [-f PATH [NAME]... | -d NAME...]
+ * @tokens: tokenized user-input
+ *
+ * Description: -f loads the plugin PATH with dlopen() and enables the
+ * builtins it registers (only NAMEs, if given); -d removes loaded
+ * builtins. With neither, lists the loaded builtins as enable -f
+ * commands. Command lookups cached by the AST are redone afterwards.
+ *
+ * Return: 1
+ */
+int ifCmdEnable(char **tokens)
+{
+	int i;
+
+	if (tokens[1] == NULL || _strcmp(tokens[1], "-p") == 0)
+	{
+		for (i = 0; i < nregs; i++)
+			if (regs[i].enabled)
+				printf("enable -f %s %s\n", libs[regs[i].lib].path,
+					   regs[i].b.name);
+		return (1);
+	}
+	if (_strcmp(tokens[1], "-f") == 0 && tokens[2] != NULL)
+		enable_from(tokens[2], tokens + 3);
+	else if (_strcmp(tokens[1], "-d") == 0 && tokens[2] != NULL)
+		disable(tokens + 2);
+	else
+	{
+		fprintf(stderr, "%s: 1: enable: usage: enable [-f PATH [NAME]... | "
+				"-d NAME...]\n", shell.name);
+		shell.status = 2;
+	}
+	shell.path_gen++; /* names may have become builtins, or stopped being */
+	return (1);
+}
+
+/**
+ * plugin_free - unloads every plugin, for leak-check builds
+ */
+void plugin_free(void)
+{
+	int i;
+
+	for (i = 0; i < PLUGIN_LIBS; i++)
+		if (libs[i].handle != NULL)
+			unload_lib(i, 1);
+}
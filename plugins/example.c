@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hsh_plugin.h"
+
+/*
+ * An example plugin, built by "make plugins":
+ *
+ *	enable -f ./plugins/example.so
+ *	hello world          # prints "hello, world"
+ *	counter hits 5       # hits=$((hits + 5)), without a fork
+ */
+
+/**
+ * hello - hello [NAME]: greets NAME, or "you"
+ * @call: the run
+ *
+ * Return: 0, 1 if the output could not be written
+ */
+static int hello(hsh_call_t *call)
+{
+	const char *name = hsh_argc(call) > 1 ? hsh_argv(call)[1] : "you";
+	char line[256];
+	int len = snprintf(line, sizeof(line), "hello, %s\n", name);
+
+	if (len < 0 || (size_t)len >= sizeof(line))
+		return (1);
+	return (hsh_write(call, 1, line, len) == len ? 0 : 1);
+}
+
+/**
+ * counter - counter NAME [STEP]: adds STEP (default 1) to the number in
+ * the variable NAME, which starts at 0
+ * @call: the run
+ *
+ * Return: 0, 2 on a usage error
+ */
+static int counter(hsh_call_t *call)
+{
+	char *const *argv = hsh_argv(call);
+	const char *old;
+	char num[24];
+	long step = 1;
+
+	if (hsh_argc(call) < 2 || hsh_argc(call) > 3)
+	{
+		hsh_write(call, 2, "counter: usage: counter NAME [STEP]\n", 36);
+		return (2);
+	}
+	if (argv[2] != NULL)
+		step = strtol(argv[2], NULL, 10);
+	old = hsh_getvar(argv[1]);
+	snprintf(num, sizeof(num), "%ld", (old ? strtol(old, NULL, 10) : 0) + step);
+	return (hsh_setvar(argv[1], num) == 0 ? 0 : 2);
+}
+
+/**
+ * hsh_plugin_init - registers the builtins
+ * @abi: HSH_PLUGIN_ABI of the shell
+ *
+ * Return: 0 on success, -1 if the shell speaks another ABI
+ */
+int hsh_plugin_init(int abi)
+{
+	if (abi != HSH_PLUGIN_ABI)
+		return (-1);
+	if (hsh_builtin_register("hello", hello, HSH_BI_PURE))
+		return (-1);
+	return (hsh_builtin_register("counter", counter, 0));
+}
@@ -0,0 +1,123 @@
+#include "main.h"
+
+#define MAX_PROC_SUBST 32
+
+/**
+ * struct procsub_s - one running <(cmd) or >(cmd)
+ * @fd: shell's end of the pipe, passed to the outer command as /dev/fd/N
+ * @pid: process running the inner command
+ */
+typedef struct procsub_s
+{
+	int fd;
+	pid_t pid;
+} procsub_t;
+
+static procsub_t procsubs[MAX_PROC_SUBST];
+static int num_procsubs;
+
+/**
+ * find_closing_paren - finds the ')' matching an already opened '('
+ * @s: text just after the opening parenthesis
+ *
+ * Description: quoted text and backslash-escaped characters (outside
+ * single quotes) do not count.
+ *
+ * Return: pointer to the matching ')', NULL if unbalanced
+ */
+char *find_closing_paren(char *s)
+{
+	int depth = 1;
+	char quote = '\0';
+
+	for (; *s; s++)
+	{
+		if (*s == '\\' && quote != '\'' && s[1])
+			s++; /* \) and "\"" are not the end */
+		else if (quote)
+		{
+			if (*s == quote)
+				quote = '\0';
+		}
+		else if (*s == '\'' || *s == '"')
+			quote = *s;
+		else if (*s == '(')
+			depth++;
+		else if (*s == ')' && --depth == 0)
+			return (s);
+	}
+	return (NULL);
+}
+
+/**
+ * proc_subst_open - starts the inner command of a <(cmd) or >(cmd)
+ * @cmd: inner command line
+ * @dir: '<' if the outer command reads from it, '>' if it writes to it
+ *
+ * Description: the inner command runs concurrently with the outer one,
+ * which gets the shell's end of the pipe as a /dev/fd/N path; nothing
+ * touches the disk. Call finish_process_substitutions() once the outer
+ * command is done.
+ *
+ * Return: the shell's end of the pipe, -1 on error
+ */
+int proc_subst_open(const char *cmd, char dir)
+{
+	int fds[2], keep, give, i;
+	pid_t pid;
+
+	if (num_procsubs >= MAX_PROC_SUBST)
+	{
+		fprintf(stderr, "%s: 1: too many process substitutions\n", shell.name);
+		return (-1);
+	}
+	if (pipe(fds) == -1)
+	{
+		perror("pipe");
+		return (-1);
+	}
+	keep = dir == '<' ? fds[0] : fds[1]; /* handed to the outer command */
+	give = dir == '<' ? fds[1] : fds[0]; /* stdout/stdin of the inner one */
+	fflush(NULL);
+	pid = fork();
+	if (pid == -1)
+	{
+		perror("fork");
+		close(fds[0]);
+		close(fds[1]);
+		return (-1);
+	}
+	if (pid == 0)
+	{
+		close(keep);
+		for (i = 0; i < num_procsubs; i++) /* siblings' ends */
+			close(procsubs[i].fd);
+		num_procsubs = 0;
+		if (dup2(give, dir == '<' ? STDOUT_FILENO : STDIN_FILENO) == -1)
+			_exit(EXIT_FAILURE);
+		close(give);
+		coproc_close_fds();
+		runLine(0, cmd);
+		childExit(shell.status);
+	}
+	close(give);
+	procsubs[num_procsubs].fd = keep;
+	procsubs[num_procsubs].pid = pid;
+	num_procsubs++;
+	return (keep);
+}
+
+/**
+ * finish_process_substitutions - closes the shell's pipe ends and reaps
+ * the inner commands started for the command that just ran
+ */
+void finish_process_substitutions(void)
+{
+	int i;
+
+	for (i = 0; i < num_procsubs; i++)
+		close(procsubs[i].fd);
+	for (i = 0; i < num_procsubs; i++)
+		waitpid(procsubs[i].pid, NULL, 0);
+	num_procsubs = 0;
+}
@@ -0,0 +1,209 @@
+#include "main.h"
+#include <sys/mman.h> /* For memfd_create() */
+
+/**
+ * open_heredoc - puts a here-document body in an anonymous memory file
+ * @body: text the command reads
+ *
+ * Return: close-on-exec fd positioned at the start of the body, -1 on error
+ */
+static int open_heredoc(const char *body)
+{
+	int fd = memfd_create("heredoc", MFD_CLOEXEC);
+	size_t len = _strlen(body), done = 0;
+	ssize_t n;
+
+	if (fd == -1)
+		return (-1);
+	while (done < len)
+	{
+		n = write(fd, body + done, len - done);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0)
+		{
+			close(fd);
+			return (-1);
+		}
+		done += n;
+	}
+	lseek(fd, 0, SEEK_SET);
+	return (fd);
+}
+
+/**
+ * open_target - opens what a file redirection points at
+ * @r: redirection (not REDIR_DUP or REDIR_CLOSE)
+ *
+ * Description: the fd is close-on-exec, so it never leaks into a
+ * command even if a later step fails; dup2() onto the target clears
+ * the flag on the copy the command actually uses.
+ *
+ * Return: new fd, -1 on error
+ */
+static int open_target(const redir_t *r)
+{
+	int flags = O_RDONLY;
+
+	if (r->op == REDIR_HEREDOC)
+		return (open_heredoc(r->target));
+	if (r->op == REDIR_OUT || r->op == REDIR_BOTH)
+		flags = O_WRONLY | O_CREAT | O_TRUNC;
+	else if (r->op == REDIR_APPEND || r->op == REDIR_BOTH_APPEND)
+		flags = O_WRONLY | O_CREAT | O_APPEND;
+	else if (r->op == REDIR_RDWR)
+		flags = O_RDWR | O_CREAT;
+	return (open(r->target, flags | O_CLOEXEC, 0644));
+}
+
+/**
+ * apply_redirection - performs one redirection in the current process
+ * @r: redirection
+ *
+ * Description: the new fd is inheritable, so once applied it is seen by
+ * every later command (that is what "exec 3>>log" is for).
+ *
+ * Return: 0 on success, -1 on error (message already printed)
+ */
+int apply_redirection(const redir_t *r)
+{
+	int fd, cached;
+
+	if (r->op == REDIR_CLOSE)
+	{
+		close(r->fd);
+		return (0);
+	}
+	if (r->op == REDIR_DUP)
+	{
+		if (dup2(_atoi_safe(r->target), r->fd) == -1)
+		{
+			fprintf(stderr, "%s: 1: %s: Bad file descriptor\n",
+					shell.name, r->target);
+			return (-1);
+		}
+		return (0);
+	}
+	cached = (shell.options & OPT_APPENDCACHE) &&
+		(r->op == REDIR_APPEND || r->op == REDIR_BOTH_APPEND);
+	fd = cached ? append_cache_get(r->target) : open_target(r);
+	if (fd == -1)
+	{
+		fprintf(stderr, "%s: 1: cannot %s %s: %s\n", shell.name,
+				r->op == REDIR_IN ? "open" : "create",
+				r->op == REDIR_HEREDOC ? "here-document" : r->target,
+				strerror(errno));
+		return (-1);
+	}
+	if (fd == r->fd) /* r->fd was closed: open() reused it */
+		fcntl(fd, F_SETFD, 0);
+	else if (dup2(fd, r->fd) == -1)
+	{
+		perror("dup2");
+		if (!cached)
+			close(fd);
+		return (-1);
+	}
+	if (r->op == REDIR_BOTH || r->op == REDIR_BOTH_APPEND)
+		dup2(r->fd, STDERR_FILENO);
+	if (fd != r->fd && !cached) /* the cache keeps its own fd */
+		close(fd);
+	return (0);
+}
+
+/**
+ * apply_redirections - performs a command's redirections, left to right
+ * @redirs: redirection plan
+ * @n: number of redirections
+ * @saved: NULL to make the changes permanent (in a child, or for exec);
+ * otherwise 2 * @n slots receiving copies of the fds each step replaces,
+ * for restore_redirections()
+ *
+ * Return: 0 on success, -1 on error (already applied steps stay applied)
+ */
+int apply_redirections(const redir_t *redirs, int n, int *saved)
+{
+	int i;
+
+	if (saved != NULL)
+		for (i = 0; i < 2 * n; i++)
+			saved[i] = -2; /* not reached */
+	for (i = 0; i < n; i++)
+	{
+		if (saved != NULL)
+		{
+			saved[2 * i] = fcntl(redirs[i].fd, F_DUPFD_CLOEXEC, 10);
+			if (redirs[i].op == REDIR_BOTH || redirs[i].op == REDIR_BOTH_APPEND)
+				saved[2 * i + 1] = fcntl(STDERR_FILENO, F_DUPFD_CLOEXEC, 10);
+		}
+		if (apply_redirection(&redirs[i]) == -1)
+			return (-1);
+	}
+	return (0);
+}
+
+/**
+ * restore_redirections - undoes apply_redirections(), right to left
+ * @redirs: redirection plan
+ * @n: number of redirections
+ * @saved: slots filled by apply_redirections(); -1 means the fd was closed
+ * before, so it is closed again
+ */
+void restore_redirections(const redir_t *redirs, int n, int *saved)
+{
+	int i, j, fd;
+
+	for (i = n - 1; i >= 0; i--)
+		for (j = 1; j >= 0; j--)
+		{
+			fd = j ? STDERR_FILENO : redirs[i].fd;
+			if (saved[2 * i + j] == -2)
+				continue;
+			if (saved[2 * i + j] == -1)
+				close(fd);
+			else
+			{
+				dup2(saved[2 * i + j], fd);
+				close(saved[2 * i + j]);
+			}
+		}
+}
+
+/**
+ * ifCmdExec - "exec [redirections] [command [args]]"
+ * @cmd: parsed command
+ *
+ * Description: with only redirections, "exec 3>>log", "exec 4<input" and
+ * "exec 3>&-" open, duplicate or close fds of the shell itself, so they
+ * stay open across commands and a logging loop writes through one fd
+ * instead of opening the file on every ">>". With a command, the
+ * redirections are applied and the command replaces the shell; if it
+ * cannot run, the shell exits with 127 (not found) or 126.
+ *
+ * Return: 1 if the command was exec, 0 otherwise
+ */
+int ifCmdExec(command_t *cmd)
+{
+	char *full_path;
+
+	if (cmd->argv[0] == NULL || _strcmp(cmd->argv[0], "exec") != 0)
+		return (0);
+	fflush(NULL); /* stdout may be about to change */
+	if (apply_redirections(cmd->redirs, cmd->nredirs, NULL) == -1)
+	{
+		shell.status = 1;
+		return (1);
+	}
+	if (cmd->argv[1] != NULL)
+	{
+		full_path = findPath(cmd->argv[1]);
+		errno = ENOENT;
+		if (full_path != NULL)
+			execve(full_path, cmd->argv + 1, cmd_envp(cmd));
+		fprintf(stderr, "%s: 1: exec: %s: %s\n", shell.name, cmd->argv[1],
+				errno == ENOENT ? "not found" : strerror(errno));
+		free(full_path);
+		safeExit(errno == ENOENT ? 127 : 126); /* the shell is gone either way */
+	}
+	return (1);
+}
@@ -0,0 +1,74 @@
+#!/bin/bash
+
+# Test cases for redirections in your custom shell.
+# This script assumes your shell is named 'hsh' and is in the current directory.
+
+HSH="$(pwd)/hsh"
+TMP=$(mktemp -d)
+failed=0
+
+# --- Helper Function ---
+run_test() {
+    local test_num=$1
+    local command=$2
+    local expected_output=$3
+    local expected_exit_code=$4
+
+    output=$(cd "$TMP" && "$HSH" -c "$command" 2>&1)
+    actual_exit_code=$?
+
+    if [ "$output" = "$(printf "$expected_output")" ] &&
+       [ "$actual_exit_code" -eq "$expected_exit_code" ]; then
+        echo "Test $test_num: PASSED"
+    else
+        echo "Test $test_num: FAILED: $command"
+        echo "  expected '$expected_output' ($expected_exit_code)"
+        echo "  got      '$output' ($actual_exit_code)"
+        failed=1
+    fi
+}
+
+# --- Test Cases ---
+
+# Files, in any position and any number
+run_test 1 "echo one >a; cat a" "one" 0
+run_test 2 ">b echo two; echo three>>b; cat <b" "two\nthree" 0
+run_test 3 "echo x >c >d; cat c; cat d" "x" 0
+run_test 4 "ls /nonexistent 2>e >f; wc -l <e" "1" 0
+run_test 5 "echo rw >g; cat <>g" "rw" 0
+
+# Duplicating and closing fds
+run_test 6 "ls /nonexistent 2>&1 >/dev/null | wc -l" "1" 0
+run_test 7 "echo err 1>&2 2>/dev/null" "err" 0
+run_test 8 "echo both &>h; ls /nonexistent &>>h; wc -l <h" "2" 0
+run_test 9 "echo closed >&-" "" 1
+
+# Inside pipelines and && / || chains; builtins restore their fds
+run_test 10 "echo hi | cat >i && cat i" "hi" 0
+run_test 11 "false || echo or >j; cat j" "or" 0
+run_test 12 "echo saved >k; echo restored" "restored" 0
+run_test 13 "cat </nonexistent || echo failed" "$HSH: 1: cannot open /nonexistent: No such file or directory\nfailed" 0
+
+# Here-documents read the lines that follow
+run_test 14 "cat <<EOF
+line 1
+line 2
+EOF
+echo after" "line 1\nline 2\nafter" 0
+run_test 15 "tr a-z A-Z <<END | cat
+shout
+END" "SHOUT" 0
+
+# Cached ">>" targets notice renames and survive cd
+run_test 18 "set -o appendcache; echo 1 >>l; echo 2 >>l; mv l l.old; echo 3 >>l; cat l.old l" "1\n2\n3" 0
+run_test 19 "set -o appendcache; echo a >>m; cd /; cd - >/dev/null; echo b >>m; cat m" "a\nb" 0
+
+# exec of a command that cannot run ends the shell
+run_test 20 "exec nosuchcmd >o; echo still-here" "$HSH: 1: exec: nosuchcmd: not found" 127
+
+# Syntax errors
+run_test 16 "echo >" "$HSH: 1: Syntax error: end of file unexpected" 2
+run_test 17 "echo 2>&x" "$HSH: 1: Syntax error: Bad fd number" 2
+
+rm -rf "$TMP"
+exit $failed
@@ -0,0 +1,157 @@
+#include "main.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#include <stdint.h>
+#define SCAN_X86 1
+#endif
+
+/*
+ * Bytes that can end a run of ordinary word characters: the NUL, blanks,
+ * operator characters, quoting characters and the starts of substitutions.
+ */
+static const char special_chars[] = " \t\n|&;<>()$'\"\\`#";
+static unsigned char special[256];
+
+/**
+ * scan_scalar - scan_plain() one byte at a time, through a 256 entry table
+ * @s: text to scan
+ *
+ * Return: number of bytes before the next special byte (or the NUL)
+ */
+static size_t scan_scalar(const char *s)
+{
+	const unsigned char *p = (const unsigned char *)s;
+
+	while (!special[*p])
+		p++;
+	return ((const char *)p - s);
+}
+
+#ifdef SCAN_X86
+/**
+ * scan_ssse3 - scan_plain() 16 bytes at a time
+ * @s: text to scan
+ *
+ * Description: the 16-byte form of scan_avx2(), with the same nibble
+ * tables. Loads are 16-byte aligned, so they never cross into an
+ * unmapped page past the NUL (AddressSanitizer is told so); bytes before
+ * @s in the first block are masked off.
+ *
+ * Return: number of bytes before the next special byte (or the NUL)
+ */
+__attribute__((target("ssse3"), no_sanitize_address))
+static size_t scan_ssse3(const char *s)
+{
+	const char *block = (const char *)((uintptr_t)s & ~(uintptr_t)15);
+	unsigned int mask = 0xFFFFU << (s - block);
+	const __m128i lo_tab = _mm_setr_epi8(
+		0x13, 0, 0x02, 0x02, 0x02, 0, 0x02, 0x02,
+		0x02, 0x03, 0x01, 0x04, 0x2C, 0, 0x04, 0);
+	const __m128i hi_tab = _mm_setr_epi8(
+		0x01, 0, 0x02, 0x04, 0, 0x08, 0x10, 0x20, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m128i nibble = _mm_set1_epi8(0x0F);
+	__m128i v, lo, hi, hit;
+
+	while (1)
+	{
+		v = _mm_load_si128((const __m128i *)block);
+		lo = _mm_shuffle_epi8(lo_tab, _mm_and_si128(v, nibble));
+		hi = _mm_shuffle_epi8(hi_tab,
+				_mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+		hit = _mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128());
+		mask &= ~(unsigned int)_mm_movemask_epi8(hit);
+		if (mask & 0xFFFFU)
+			return (block + __builtin_ctz(mask) - s);
+		mask = ~0U;
+		block += 16;
+	}
+}
+
+/**
+ * scan_avx2 - scan_plain() 32 bytes at a time
+ * @s: text to scan
+ *
+ * Description: classifies each byte with two 16-entry nibble tables
+ * (vpshufb): a byte is special when the group bits of its low nibble
+ * and of its high nibble intersect. The groups are the high nibbles
+ * that hold special bytes: 0x0 (NUL, \t, \n), 0x2 (space " # $ & ' ( )),
+ * 0x3 (; < >), 0x5 (\), 0x6 (`) and 0x7 (|). Loads are 32-byte aligned,
+ * as in scan_ssse3().
+ *
+ * Return: number of bytes before the next special byte (or the NUL)
+ */
+__attribute__((target("avx2"), no_sanitize_address))
+static size_t scan_avx2(const char *s)
+{
+	const char *block = (const char *)((uintptr_t)s & ~(uintptr_t)31);
+	unsigned int mask = ~0U << (s - block);
+	const __m256i lo_tab = _mm256_setr_epi8(
+		0x13, 0, 0x02, 0x02, 0x02, 0, 0x02, 0x02,
+		0x02, 0x03, 0x01, 0x04, 0x2C, 0, 0x04, 0,
+		0x13, 0, 0x02, 0x02, 0x02, 0, 0x02, 0x02,
+		0x02, 0x03, 0x01, 0x04, 0x2C, 0, 0x04, 0);
+	const __m256i hi_tab = _mm256_setr_epi8(
+		0x01, 0, 0x02, 0x04, 0, 0x08, 0x10, 0x20, 0, 0, 0, 0, 0, 0, 0, 0,
+		0x01, 0, 0x02, 0x04, 0, 0x08, 0x10, 0x20, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m256i nibble = _mm256_set1_epi8(0x0F);
+	__m256i v, lo, hi, hit;
+
+	while (1)
+	{
+		v = _mm256_load_si256((const __m256i *)block);
+		lo = _mm256_shuffle_epi8(lo_tab, _mm256_and_si256(v, nibble));
+		hi = _mm256_shuffle_epi8(hi_tab,
+				_mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+		hit = _mm256_cmpeq_epi8(_mm256_and_si256(lo, hi),
+								_mm256_setzero_si256());
+		mask &= ~(unsigned int)_mm256_movemask_epi8(hit);
+		if (mask)
+			return (block + __builtin_ctz(mask) - s);
+		mask = ~0U;
+		block += 32;
+	}
+}
+#endif
+
+static size_t scan_resolve(const char *s);
+static size_t (*scan_impl)(const char *s) = scan_resolve;
+
+/**
+ * scan_resolve - picks the widest scanner the CPU supports, on first use
+ * @s: text to scan
+ *
+ * Return: what the chosen scanner returns for @s
+ */
+static size_t scan_resolve(const char *s)
+{
+	int i;
+
+	special[0] = 1;
+	for (i = 0; special_chars[i]; i++)
+		special[(unsigned char)special_chars[i]] = 1;
+	scan_impl = scan_scalar;
+#ifdef SCAN_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		scan_impl = scan_avx2;
+	else if (__builtin_cpu_supports("ssse3"))
+		scan_impl = scan_ssse3;
+#endif
+	return (scan_impl(s));
+}
+
+/**
+ * scan_plain - measures a run of ordinary word characters
+ * @s: text to scan
+ *
+ * Description: every token boundary the lexer looks for goes through
+ * here. On x86 the search runs 32 (AVX2) or 16 (SSSE3) bytes at a time,
+ * chosen at run time; elsewhere it falls back to a table lookup.
+ *
+ * Return: number of bytes before the next special byte (or the NUL)
+ */
+size_t scan_plain(const char *s)
+{
+	return (scan_impl(s));
+}
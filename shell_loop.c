@@ -4,33 +4,31 @@
  * shellLoop - main loop for input/output.
  *
  * @isAtty: is interactive mode
- * @argv: args passed into main()
+ * @stream: where command lines are read from (stdin or a script file)
+ *
+ * Description: the line buffer is reused and every per-line temporary
+ * comes from the arena reset at the top of each iteration, so once
+ * lines repeat the loop makes no malloc() calls.
  */
-void shellLoop(int isAtty, char *argv[])
+void shellLoop(int isAtty, FILE *stream)
 {
-	size_t size;
-	char *user, *hostname, path[PATH_MAX], *input, **tokens = NULL;
-	/*int custom_cmd_rtn;*/
-	int num_commands;
-	char **commands = NULL;
+	size_t size = 0;
+	char *user, *hostname, path[PATH_MAX], *input = NULL;
 
+	shell.input = stream;
+	shell.interactive = isAtty;
 	while (1)
 	{
-		/* Initialize variables */
-		getcwd(path, sizeof(path));
-		user = getUser();
-		hostname = getHostname();
-		size = 0;
-		input = NULL;
-		tokens = NULL;
+		arena_reset();
 		if (isAtty)
 		{
+			getcwd(path, sizeof(path));
+			user = getUser();
+			hostname = getHostname();
 			printPrompt(isAtty, user, hostname, path);
 		}
-		free(user);
-		free(hostname);
 
-		if (getline(&input, &size, stdin) == -1)
+		if (getline(&input, &size, stream) == -1)
 		{
 			if (isAtty)
 			{
@@ -39,7 +37,9 @@ void shellLoop(int isAtty, char *argv[])
 					   CLR_RED_BOLD, CLR_YELLOW_BOLD, CLR_DEFAULT);
 			}
 			free(input);
-			safeExit(EXIT_SUCCESS);
+			if (stream != stdin)
+				fclose(stream);
+			safeExit(shell.status);
 		}
 
 		size_t len = _strlen(input);
@@ -48,75 +48,101 @@ void shellLoop(int isAtty, char *argv[])
 			input[len - 1] = '\0';
 		}
 
-		/* Piping Logic */
-		if (_strchr(input, '|'))
-		{ /* Check if there's a pipe in the command */
-			if (split_command_line_on_pipe(input, &commands, &num_commands) == 0)
-			{
-				execute_pipe_command(commands, num_commands);
-				for (int i = 0; i < num_commands; i++)
-				{
-					free(commands[i]);
-				}
-				free(commands);
-				free(input);
-				continue;
-			}
-			else
-			{
-				fprintf(stderr, "Failed to split commands\n");
-			}
-		}
+		runLine(isAtty, input);
+	}
+}
 
-		/* Logical Operators */
-		else if (_strstr(input, "&&") || _strstr(input, "||") || _strstr(input, ";"))
-		{
-			execute_logical_commands(input);
-			free(input);
-			continue;
-		}
-		else if (_strstr(input, ">>"))
-		{
-			DoubleRightDirect(input);
-			free(input);
-			continue;
-		}
-		else if (_strstr(input, ">"))
-		{
-			RightDirect(input);
-			free(input);
-			continue;
-		}
-		else if (_strstr(input, "<"))
-		{
-			LeftDirect(input);
-			free(input);
-			continue;
-		}
-		else if (_strstr(input, "<<"))
-		{
-			DoubleLeftDirect(input);
-			free(input);
-			continue;
-		}
-		else // Single command.
+/**
+ * runString - runs every line of a "-c" command string
+ *
+ * @string: command string, lines separated by newlines
+ *
+ * Description: the string is read as a stream, like a script, so
+ * here-documents can take their body from the following lines.
+ */
+void runString(const char *string)
+{
+	char *line = NULL;
+	size_t size = 0;
+	ssize_t len;
+	int c;
+
+	if (*string == '\0')
+		return;
+	shell.input = fmemopen((char *)string, _strlen(string), "r");
+	if (shell.input == NULL)
+	{
+		perror("fmemopen");
+		return;
+	}
+	while ((len = getline(&line, &size, shell.input)) != -1)
+	{
+		arena_reset();
+		if (len > 0 && line[len - 1] == '\n')
+			line[len - 1] = '\0';
+		c = getc(shell.input);
+		shell.tail_exec = (c == EOF);
+		if (c != EOF)
+			ungetc(c, shell.input);
+		runLine(0, line);
+		shell.tail_exec = 0;
+	}
+	free(line);
+	fclose(shell.input);
+	shell.input = NULL;
+}
+
+/**
+ * runLine - lexes, parses and runs one command line
+ *
+ * @isAtty: is interactive mode
+ * @input: command line without its trailing newline
+ *
+ * Description: the line is tokenized in one pass and parsed into an AST
+ * before anything runs, so quoting, operators and redirections are seen
+ * the same way everywhere. A syntax error runs nothing and sets $? to 2.
+ * Parsed lines are kept in a cache, so a line seen before (a script
+ * loop, a repeated -c string) skips the lexer and parser entirely.
+ */
+void runLine(int isAtty, const char *input)
+{
+	token_t *tokens = NULL;
+	node_t *tree;
+	ast_entry_t *cached = ast_cache_lookup(input);
+	int ntok = 0, error = 0, tail_exec = shell.tail_exec;
+
+	shell.tail_exec = 0;
+	reapCoprocs();
+	reap_background();
+	if (cached != NULL)
+		tree = cached->tree;
+	else
+	{
+		ntok = lex_line(input, &tokens);
+		if (ntok == -1)
 		{
-			/* Parse and Execute Single Command */
-			tokens = parse_command(input);
-			if (tokens == NULL)
-			{
-				free(input);
-				continue;
-			}
-			if (tokens[0] != NULL)
-				executeIfValid(isAtty, argv, tokens, input);
-			free(tokens);
-			free(input);
+			shell.status = 2;
+			return;
 		}
-
-		/* --- Cleanup (ALWAYS done after each command) --- */
-		// free(tokens);
-		// free(input);
+		tree = parse_tokens(tokens, &error);
+		if (tree != NULL)
+			cached = ast_cache_insert(input, tokens, ntok, tree);
+	}
+	if (error)
+		shell.status = 2;
+	else if (tree != NULL)
+	{
+		/* only a lone simple command may replace the shell */
+		shell.tail_exec = tail_exec && tree->type == N_COMMAND;
+		run_node(tree, isAtty);
+		shell.tail_exec = 0;
+	}
+	if (cached != NULL)
+		ast_cache_release(cached);
+	else
+	{
+		free_tree(tree);
+		free_tokens(tokens, ntok);
 	}
 }
 /**
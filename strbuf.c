@@ -0,0 +1,58 @@
+#include "main.h"
+
+/**
+ * sb_reserve - makes room for at least extra more bytes plus a NUL
+ * @sb: string buffer
+ * @extra: number of bytes about to be appended
+ *
+ * Description: the bytes live in the per-line arena, so buffers are
+ * never freed; one being appended to usually grows in place.
+ *
+ * Return: 0 on success, -1 if out of memory
+ */
+int sb_reserve(strbuf_t *sb, size_t extra)
+{
+	size_t cap = sb->cap ? sb->cap : 64;
+	char *data;
+
+	if (sb->len + extra + 1 <= sb->cap)
+		return (0);
+	while (cap < sb->len + extra + 1)
+		cap *= 2; /* doubling keeps appends amortized O(1) */
+	data = arena_realloc(sb->data, sb->cap, cap);
+	if (data == NULL)
+		return (-1);
+	sb->data = data;
+	sb->cap = cap;
+	return (0);
+}
+
+/**
+ * sb_append - appends n bytes to a string buffer, keeping it NUL terminated
+ * @sb: string buffer
+ * @s: bytes to append
+ * @n: number of bytes
+ *
+ * Return: 0 on success, -1 if realloc failed
+ */
+int sb_append(strbuf_t *sb, const char *s, size_t n)
+{
+	if (sb_reserve(sb, n) == -1)
+		return (-1);
+	memcpy(sb->data + sb->len, s, n);
+	sb->len += n;
+	sb->data[sb->len] = '\0';
+	return (0);
+}
+
+/**
+ * sb_putc - appends one character to a string buffer
+ * @sb: string buffer
+ * @c: character
+ *
+ * Return: 0 on success, -1 if realloc failed
+ */
+int sb_putc(strbuf_t *sb, char c)
+{
+	return (sb_append(sb, &c, 1));
+}
@@ -39,10 +39,10 @@ char *_strchr(const char *s, char c)
 {
 	int i;
 
-	if ((s == NULL) || (_strlen(s) == 0))
+	if (s == NULL)
 		return (NULL);
 
-	for (i = 0; i < _strlen(s); i++)
+	for (i = 0; s[i] != '\0'; i++) /* one pass, not _strlen() per char */
 	{
 		if (s[i] == c)
 			return ((char *)&s[i]);
@@ -140,7 +140,8 @@ char *_strtok_r(char *str, const char *delim, char **saveptr)
 	if (!str) /*No more tokens.*/
 		return (NULL);
 	/* Find beginning of token (skip delimiters)*/
-	str += _strcspn(str, delim);
+	while (*str != '\0' && _strchr(delim, *str) != NULL)
+		str++;
 	if (*str == '\0') /* If we hit the end, return NULL */
 	{
 		*saveptr = NULL;